@@ -0,0 +1,48 @@
+// =-=-=-=-=-=-=-
+// Minimal stand-ins for the iRODS server types used by geoMetadata,
+// for tools built with -DGEOMETA_STANDALONE that collect metadata
+// instead of writing it to the catalog
+#ifndef GEOMETA_STANDALONE_HPP
+#define GEOMETA_STANDALONE_HPP
+
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <strings.h>
+
+#define LOG_DEBUG 7
+#define LOG_NOTICE 5
+#define LOG_ERROR 3
+
+#define MAX_NAME_LEN 1088
+#define CAT_NO_ROWS_FOUND -808000
+#define CATALOG_ALREADY_HAS_ITEM_BY_THAT_NAME -809000
+#define KeyValPair_MS_T "KeyValPair_PI"
+
+typedef struct {
+  int status;
+  void *rsComm;
+} ruleExecInfo_t;
+
+typedef struct {
+  char *label;
+  char *type;
+  void *inOutStruct;
+  void *inpOutBuf;
+} msParam_t;
+
+inline void rodsLog(int level, const char *format, ...) {
+
+  if(level > LOG_NOTICE)
+    return;
+
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, level == LOG_ERROR ? "ERROR: " : "NOTICE: ");
+  vfprintf(stderr, format, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+
+}
+
+#endif
@@ -1,4 +1,5 @@
 // =-=-=-=-=-=-=-
+#ifndef GEOMETA_STANDALONE
 #include "apiHeaderAll.hpp"
 #include "msParam.hpp"
 #include "reGlobalsExtern.hpp"
@@ -6,12 +7,26 @@
 #include "reAction.hpp"
 #include "modAVUMetadata.hpp"
 #include "dataObjOpr.hpp"
+#else
+//tools built outside the server collect metadata instead of writing it
+#include "geometa_standalone.hpp"
+#endif
 
 // =-=-=-=-=-=-=-
 // STL Includes
 #include <string>
 #include <iostream>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <map>
+#include <fstream>
+#include <cmath>
+#include <set>
+#include <functional>
+#include <mutex>
+#include <tuple>
 
 
 // =-=-=-=-=-=-=-
@@ -21,30 +36,304 @@
 #include <ogrsf_frmts.h> 
 #include <cpl_conv.h>
 #include <netcdf.h>
+#include <gdal_alg.h>
+
+// =-=-=-=-=-=-=-
+// OpenSSL Includes
+#include <openssl/sha.h>
+#include <openssl/evp.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// =-=-=-=-=-=-=-
+// POSIX Includes
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // =-=-=-=-=-=-=-
 // Boost Includes
 #include <boost/filesystem.hpp>
 
 
+//summary of a single vector layer, filled in by the
+//layer extraction workers
+struct vectorLayerInfo {
+  std::string name;
+  std::string projection;
+  std::string srsWkt;
+  std::vector<std::string> fields;
+  long long featureCount;
+  int hasExtent;
+  int transformed;
+  OGREnvelope extent;
+  OGREnvelope extentLatLon;
+  int done;
+
+  vectorLayerInfo() : featureCount(0), hasExtent(0), transformed(0), done(0) {}
+};
+
+//bounds of a raster dataset in its natural and
+//geographic coordinates
+struct rasterBounds {
+  int xsize;
+  int ysize;
+  int bands;
+  int georeferenced;
+  int transformed;
+  std::string projection;
+  double northlimit, eastlimit, westlimit, southlimit;
+  double latmax, lonmax, lonmin, latmin;
+
+  rasterBounds() : xsize(0), ysize(0), bands(0), georeferenced(0), transformed(0) {}
+};
+
+//records along the unlimited dimension of a NetCDF file and the
+//range of its coordinate variable over the records that were read
+struct unlimitedCoverage {
+  std::string dimension;
+  std::string units;
+  size_t length;
+  int hasRange;
+  double min, max;
+
+  unlimitedCoverage() : length(0), hasRange(0), min(0), max(0) {}
+};
+
+//transforms to the geographic coordinate system of a dataset,
+//keyed by the dataset's WKT. Coordinate transformations are not
+//thread-safe, so every worker thread owns its own cache
+class transformCache {
+private:
+  std::map<std::string, OGRSpatialReference *> sourceRefs;
+  std::map<std::string, OGRCoordinateTransformation *> transforms;
+
+public:
+  ~transformCache();
+
+  OGRCoordinateTransformation *getTransform(const char *pszWkt, OGRSpatialReference **hSpatialRef);
+};
+
+// =-=-=-=-=-=-=-
+// Threading contract
+//
+// - a geoMetadata instance belongs to the thread that created it, but
+//   any number of instances may extract concurrently (geometa_scan,
+//   geometa_daemon)
+// - GDAL datasets, OGR datasources and coordinate transformations are
+//   never shared between threads. Worker threads get them from their
+//   own geoContext, the main thread owns poDataset and poDS
+// - each transformation carries its own PROJ context, so owning the
+//   transformations per thread also keeps PROJ contexts per thread
+// - drivers are registered before the first concurrent extraction,
+//   options are read once and are read-only afterwards
+// - results are written by workers only into their own item slots and
+//   are turned into AVUs by the owning thread after the workers join
+
+//per-thread GDAL/OGR state, see geoContext::current. Handles returned
+//by openRaster/openVector stay owned by the context and remain valid
+//until the thread opens more than maxHandles other files
+class geoContext {
+private:
+  struct cachedHandle {
+    std::string path;
+    int isVector;
+    long long size;
+    long long mtime;
+    GDALDataset *raster;
+    OGRDataSource *vector;
+  };
+
+  std::vector<cachedHandle> handles;
+  transformCache geographic;
+  std::map<std::string, OGRCoordinateTransformation *> wgs84;
+
+  static const size_t maxHandles;
+
+  void *open(const char *path, int isVector);
+
+  static void close(cachedHandle &handle);
+
+public:
+  ~geoContext();
+
+  static geoContext &current();
+
+  //transforms to the geographic coordinate system of a projection
+  transformCache &transforms() { return geographic; }
+
+  //transform from a spatial reference to EPSG:4326
+  OGRCoordinateTransformation *getWGS84Transform(OGRSpatialReference *hSpatialRef);
+
+  GDALDataset *openRaster(const char *path);
+
+  OGRDataSource *openVector(const char *path);
+
+  void release();
+};
+
+//bounded footprint of a stream of vertices. In convex mode the point
+//buffer is reduced to its hull whenever it fills up, in grid mode the
+//vertices and segments are marked on a fixed occupancy grid over the
+//known extent. Builders are filled per thread and merged at the end
+class hullBuilder {
+private:
+  std::vector<double> xs, ys;
+  std::vector<GByte> grid;
+  int gridSize;
+  OGREnvelope extent;
+
+  void reduce();
+
+  void mark(double x, double y);
+
+public:
+  static const size_t maxPoints;
+
+  hullBuilder();
+
+  hullBuilder(const OGREnvelope &gridExtent, int size);
+
+  void addPoint(double x, double y);
+
+  void addSegment(double x1, double y1, double x2, double y2);
+
+  void addGeometry(OGRGeometry *hGeometry);
+
+  void merge(const hullBuilder &other);
+
+  OGRGeometry *convexHull();
+
+  int gridMask(std::vector<GByte> &mask, double *adfTransform);
+};
+
+//attribute, value, unit triple for metadata that cannot go
+//through the key value pairs (repeated attributes or units)
+struct geoAVU {
+  std::string name;
+  std::string value;
+  std::string unit;
+  int keyValue;		/* set through addMeta, one value per name */
+  int replace;			/* set through replaceMetaUnit, written with set */
+
+  geoAVU() : keyValue(0), replace(0) {}
+};
+
+//in-memory stand-in for the catalog, so that tools without a server
+//(geometa_scan --catalog) run every catalog path of an extraction:
+//re-extraction, NetCDF appends and quicklooks. One instance may be
+//shared by any number of concurrent extractions
+class recordingCatalog {
+private:
+  //attribute, value, unit, ordered by attribute for set
+  typedef std::tuple<std::string, std::string, std::string> storedAVU;
+
+  std::map<std::string, std::set<storedAVU> > metadata;
+  std::map<std::string, size_t> objects;
+  std::mutex lock;
+
+public:
+  //add, set or mod of one AVU of objPath, failing like rsModAVUMetadata
+  int modify(const char *op, const std::string &objPath, const geoAVU &avu, const char *newValue);
+
+  //AVUs of objPath with one of the given names, every AVU when empty
+  void query(const std::string &objPath, const std::set<std::string> &names, std::vector<geoAVU> &stored);
+
+  //replaces every AVU of objPath by rows, as returned by query
+  void restore(const std::string &objPath, const std::vector<geoAVU> &rows);
+
+  //companion data object, only its size is kept
+  void putObject(const std::string &objPath, size_t size);
+
+  //reads logical path, attribute, value, unit lines as written by
+  //geometa_scan, returns the number of AVUs or -1
+  long load(const char *path);
+};
+
+
 class geoMetadata {
 private:
     // iRODS server handle
   ruleExecInfo_t *rei;
-  char geoExt[5];
+  char geoExt[16];
   int geoType;
   char objType[6];
   char objName[512];
   char filePath[512];
   msParam_t kvpairsparam;
+  std::vector<geoAVU> keyMeta;
+  std::vector<geoAVU> unitMeta;
+  std::vector<geoAVU> *sink;
+  recordingCatalog *catalog;
   GDALDataset *poDataset;
   OGRDataSource *poDS;
+  int sidecarsChecked;
+  int opened;
+  std::vector<vectorLayerInfo> layers;
+  std::string checksum;
+  int catalogCalls;
+  int archiveMember;
 
   static const std::vector<std::string> rastertypes;
   static const std::vector<std::string> vectortypes;
+  static const std::vector<std::string> shapefiletypes;
+  static const std::vector<std::string> archivetypes;
+
+  //upper bound on worker threads per extraction, the agent
+  //shares the host with other agents
+  static const int maxThreads;
+  //iRODS AVU values are limited to 2700 characters
+  static const size_t maxValueLength;
+  //upper bound on the number of chunks written for an inventory
+  static const int maxChunks;
+  static const int variableMaxChunks;
+  static const size_t maxLongName;
+
+  //footprints are computed from at most this many pixels and
+  //simplified to at most this many vertices so they fit one AVU
+  static const int footprintMaxPixels;
+  static const int footprintMaxVertices;
+  //vector footprints: occupancy grid size of the concave
+  //approximation and features per streaming work item
+  static const int footprintGridSize;
+  static const long long footprintChunkFeatures;
+
+  //longest side of quicklook thumbnails and the share of pixels
+  //clipped at each end by the percentile stretch
+  static const int quicklookSize;
+  static const double quicklookClip;
+  static const size_t checksumBlockSize;
+  static const char *const extractorVersion;
+  static const size_t coordinateBlockSize;
+  //default for the netcdf_member_limit option
+  static const size_t netcdfMemoryLimit;
+
+  static int workerCount(int nItems);
+
+  //calls fn(item, worker) for every item on up to workerCount(nItems)
+  //threads, inline on the calling thread when one is enough
+  static void runWorkers(int nItems, const std::function<void(int, int)> &fn);
+
+  static std::map<std::string, std::string> loadOptions();
+
+  static std::string getOption(const char *key);
+
+  static int optionEnabled(const char *key);
 
   int geospatialType();
 
+  void openDatasets();
+
+  int extractAny();
+
+  int extractRemote(const char *socketPath);
+
+  int extractLocal();
+
   void setGeoExtension();
 
   int shapefileComplete();
@@ -53,26 +342,137 @@ private:
 
   void addMeta(char *key, char *value);
 
+  void addMetaUnit(const char *key, const char *value, const char *unit);
+
+  //returns the number of items stored
+  int addChunkedMeta(const char *key, const std::vector<std::string> &items, int chunkLimit);
+
+  //queued like addMetaUnit, but written with set so that it replaces
+  //every stored AVU of the same name
+  void replaceMetaUnit(const char *key, const char *value, const char *unit);
+
+  int setMetaUnits();
+
+  //one rsModAVUMetadata request, or its recording
+  int modifyMeta(const char *op, const geoAVU &avu, const char *newValue);
+
+  int readStoredMeta(const char *nameCondition, std::vector<geoAVU> &stored);
+
   void extractVectorBasicMeta();
 
   void extractVectorBounds();
 
+  void extractVectorLayers();
+
+  //first layer with an extent, whose spatial reference the bounds and
+  //footprint are taken in, -1 when no layer has one
+  int referenceLayer() const;
+
+  static void extractLayerInfo(OGRLayer *hLayer, vectorLayerInfo &info);
+
   void extractRasterBasicMeta();
 
   void extractRasterBounds();
 
+  static void computeRasterBounds(GDALDataset *hDataset, transformCache &cache, rasterBounds &bounds);
+
+  void extractSubdatasets(int withDescriptions);
+
+  static void buildValidMask(const float *pixels, GByte *mask, size_t count, float nodata);
+
+  void extractRasterFootprint(transformCache &cache);
+
+  static OGRGeometry *polygonizeMask(std::vector<GByte> &mask, int xSize, int ySize, double *adfTransform, int exteriorOnly);
+
+  void extractVectorFootprint();
+
+  static int readQuicklookBand(const char *path, int iBand, int xSize, int ySize, GByte *pixels);
+
+  void extractQuicklook();
+
+  int putQuicklook(const char *objPath, const GByte *data, int len);
+
+  void addFootprintMeta(OGRGeometry *footprint, OGRCoordinateTransformation *hTransform);
+
   void extractMetaShp();
 
+  static int readTextAttribute(int ncid, int varid, const char *name, std::string &value);
+
+  static std::string inventoryField(const std::string &field);
+
+  static int readUnlimitedCoverage(int ncid, int unlimdimid, size_t from, unlimitedCoverage &coverage);
+
+  static std::string unlimitedMarker(int ncid, int unlimdimid, size_t records);
+
+  void addUnlimitedMeta(const unlimitedCoverage &coverage, const std::string &marker);
+
+  int extractNetCDFAppend();
+
+  int openNetCDF(int *ncid, std::vector<char> &buffer);
+
   void extractMetaNetCDF();
 
   void extractMetaGeoTiff();
+
+  static void listArchive(const std::string &vsiRoot, const std::string &dir, std::vector<std::string> &members);
+
+  void extractMetaArchive();
+
+  static std::string sha2Encode(const unsigned char *digest);
+
+  static std::string sha2Of(const std::string &data);
+
+  static int computeChecksum(const char *path, std::string &checksum);
+
+  void addChecksumMeta(const std::string &digest);
   
 
 public:
   geoMetadata( ruleExecInfo_t *in_rei, char *logPath, char *phyPath ); 
 
+  //collects the extracted metadata into in_sink rather than the catalog,
+  //in_sidecarsChecked skips the shapefile sidecar probe when the caller
+  //already knows the .shx, .dbf and .prj files are present
+  geoMetadata( ruleExecInfo_t *in_rei, const char *logPath, const char *phyPath,
+	       std::vector<geoAVU> *in_sink, int in_sidecarsChecked );
+
+  //writes the extracted metadata and quicklooks to in_catalog, as an
+  //agent would to the iRODS catalog
+  geoMetadata( ruleExecInfo_t *in_rei, const char *logPath, const char *phyPath,
+	       recordingCatalog *in_catalog, int in_sidecarsChecked );
+
   ~geoMetadata();
 
   int extractGeoMeta();
 
+  //1 = raster, 2 = vector, 3 = archive, 0 = unsupported file extension
+  static int extensionType(const std::string &ext);
+
+  //true for the files making up a shapefile (.shp, .shx, .dbf, .prj)
+  static int shapefilePart(const std::string &ext);
+
+  //logical path the metadata belongs to, a shapefile part
+  //is redirected to its .shp
+  const char *logicalPath() const { return objName; }
+
+  //tab separated record fields as exchanged with the extraction
+  //daemon and written by geometa_scan
+  static void appendEscaped(std::string &out, const std::string &field);
+
+  static std::string unescape(const std::string &field);
+
+  //catalog requests the extraction made, or would have made when
+  //collecting into a sink
+  int catalogCallCount() const { return catalogCalls; }
+
+  //sha2:<base64> checksum streamed during extraction, empty unless
+  //the checksum option is set
+  const std::string &contentChecksum() const { return checksum; }
+
+#ifndef GEOMETA_STANDALONE
+  //records contentChecksum as the catalog checksum of the replica
+  //when it has none, with checksum=register
+  int registerChecksum(dataObjInfo_t *dataObjInfo);
+#endif
+
 }; 	// class geoMetadata
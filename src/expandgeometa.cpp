@@ -0,0 +1,161 @@
+// =-=-=-=-=-=-=-
+// msiExpandGeoMetaVariables: expands the compact NetCDF variable
+// inventory written by msiExtractGeoMeta (netcdf=compact) back into
+// one key value pair per variable, variable name -> long name.
+//
+//   msiExpandGeoMetaVariables(*objPath, *variables)
+//
+// The inventory is read from the variables AVUs of the object,
+// concatenated in chunk_N order and split on unescaped ';', each
+// item being name or name=long_name with '\' escaping '\', ';', '='.
+// An inventory holding fewer variables than the variablecount AVU
+// (truncated at extraction) is returned but reported as an error.
+// Built as its own plugin, libmsiExpandGeoMetaVariables.so
+#include "geometadata.hpp"
+
+
+//splits on unescaped separators and removes the escaping
+static void splitInventory(const std::string &inventory, keyValPair_t *variables) {
+
+  std::string name, longName;
+  std::string *field = &name;
+
+  for(size_t i = 0; i <= inventory.size(); i++)
+    {
+      if(i == inventory.size() || inventory[i] == ';')
+	{
+	  if(!name.empty())
+	    addKeyVal(variables, name.c_str(), longName.c_str());
+	  name.clear();
+	  longName.clear();
+	  field = &name;
+	}
+      else if(inventory[i] == '=' && field == &name)
+	field = &longName;
+      else
+	{
+	  if(inventory[i] == '\\' && i + 1 < inventory.size())
+	    i++;
+	  *field += inventory[i];
+	}
+    }
+
+}
+
+extern "C" {
+
+  // =-=-=-=-=-=-=-
+  int msiExpandGeoMetaVariables( msParam_t* obj_path, msParam_t* variables_out, ruleExecInfo_t* rei ) {
+    char collName[MAX_NAME_LEN], dataName[MAX_NAME_LEN];
+    char condition[MAX_NAME_LEN + 8];
+    genQueryInp_t genQueryInp;
+    genQueryOut_t *genQueryOut = NULL;
+    std::map<int, std::string> chunks;
+    int variableCount = -1;
+    int status;
+
+    // Sanity checks
+    if ( !rei || !rei->rsComm ) {
+      rodsLog( LOG_ERROR, "msiExpandGeoMetaVariables: Input rei or rsComm is NULL." );
+      return ( SYS_INTERNAL_NULL_INPUT_ERR );
+    }
+
+    char *objPath = parseMspForStr( obj_path );
+    if ( objPath == NULL ) {
+      rodsLog( LOG_ERROR, "msiExpandGeoMetaVariables: Input object path is NULL." );
+      return ( SYS_INTERNAL_NULL_INPUT_ERR );
+    }
+
+    status = splitPathByKey( objPath, collName, MAX_NAME_LEN, dataName, MAX_NAME_LEN, '/' );
+    if ( status < 0 ) {
+      rodsLog( LOG_ERROR, "msiExpandGeoMetaVariables: invalid object path %s", objPath );
+      return ( status );
+    }
+
+    bzero( &genQueryInp, sizeof( genQueryInp ) );
+    genQueryInp.maxRows = MAX_SQL_ROWS;
+    addInxIval( &genQueryInp.selectInp, COL_META_DATA_ATTR_NAME, 1 );
+    addInxIval( &genQueryInp.selectInp, COL_META_DATA_ATTR_VALUE, 1 );
+    addInxIval( &genQueryInp.selectInp, COL_META_DATA_ATTR_UNITS, 1 );
+    snprintf( condition, sizeof condition, "= '%s'", collName );
+    addInxVal( &genQueryInp.sqlCondInp, COL_COLL_NAME, condition );
+    snprintf( condition, sizeof condition, "= '%s'", dataName );
+    addInxVal( &genQueryInp.sqlCondInp, COL_DATA_NAME, condition );
+    addInxVal( &genQueryInp.sqlCondInp, COL_META_DATA_ATTR_NAME, "in ('variables', 'variablecount')" );
+
+    //rows come back in no particular order, the unit numbers the chunks
+    status = rsGenQuery( rei->rsComm, &genQueryInp, &genQueryOut );
+    while ( status >= 0 && genQueryOut != NULL ) {
+      sqlResult_t *names = getSqlResultByInx( genQueryOut, COL_META_DATA_ATTR_NAME );
+      sqlResult_t *values = getSqlResultByInx( genQueryOut, COL_META_DATA_ATTR_VALUE );
+      sqlResult_t *units = getSqlResultByInx( genQueryOut, COL_META_DATA_ATTR_UNITS );
+
+      for ( int i = 0; names != NULL && values != NULL && units != NULL && i < genQueryOut->rowCnt; i++ ) {
+	int chunk = 0;
+	if ( strcmp( &names->value[names->len * i], "variablecount" ) == 0 )
+	  variableCount = atoi( &values->value[values->len * i] );
+	else if ( sscanf( &units->value[units->len * i], "chunk_%d", &chunk ) == 1 )
+	  chunks[chunk] = &values->value[values->len * i];
+      }
+
+      if ( genQueryOut->continueInx <= 0 )
+	break;
+
+      genQueryInp.continueInx = genQueryOut->continueInx;
+      freeGenQueryOut( &genQueryOut );
+      status = rsGenQuery( rei->rsComm, &genQueryInp, &genQueryOut );
+    }
+
+    freeGenQueryOut( &genQueryOut );
+    clearGenQueryInp( &genQueryInp );
+
+    if ( status < 0 && status != CAT_NO_ROWS_FOUND ) {
+      rodsLog( LOG_ERROR, "msiExpandGeoMetaVariables: query failed for %s, status = %d", objPath, status );
+      return ( status );
+    }
+
+    //an item never spans two chunks, so the chunks join with ';'
+    std::string inventory;
+    for ( std::map<int, std::string>::iterator it = chunks.begin(); it != chunks.end(); ++it ) {
+      if ( !inventory.empty() )
+	inventory += ";";
+      inventory += it->second;
+    }
+
+    keyValPair_t *variables = ( keyValPair_t * ) malloc( sizeof( keyValPair_t ) );
+    bzero( variables, sizeof( keyValPair_t ) );
+    splitInventory( inventory, variables );
+
+    fillMsParam( variables_out, NULL, KeyValPair_MS_T, variables, NULL );
+
+    //chunks missing in the catalog or cut off at extraction
+    if ( variableCount >= 0 && variables->len != variableCount ) {
+      rodsLog( LOG_ERROR, "msiExpandGeoMetaVariables: %s lists %d of %d variables",
+	       objPath, variables->len, variableCount );
+      return ( SYS_INTERNAL_ERR );
+    }
+
+    // Done
+    return 0;
+
+  }
+
+  // =-=-=-=-=-=-=-
+  // Create the plugin factory function which will return a microservice
+  // table entry
+  irods::ms_table_entry*  plugin_factory() {
+    // =-=-=-=-=-=-=-
+    // allocate a microservice plugin which takes the number of function
+    // params as a parameter to the constructor
+    irods::ms_table_entry* msvc = new irods::ms_table_entry( 2 );
+
+    // =-=-=-=-=-=-=-
+    // add the microservice function as an operation to the plugin
+    msvc->add_operation( "msiExpandGeoMetaVariables", "msiExpandGeoMetaVariables" );
+
+    // =-=-=-=-=-=-=-
+    // return the newly created microservice plugin
+    return msvc;
+  }
+
+}; // extern "C"
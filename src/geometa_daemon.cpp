@@ -0,0 +1,239 @@
+// =-=-=-=-=-=-=-
+// geometa_daemon: long-lived local extraction service for
+// msiExtractGeoMeta. Keeps GDAL drivers, PROJ data and caches warm
+// across the short-lived iRODS agents that call it.
+//
+// Protocol, one request per connection over a Unix socket:
+//   request   logical path <TAB> physical path <LF>
+//   response  OK <TAB> status <TAB> logical path <LF>
+//             kind <TAB> attribute <TAB> value <TAB> unit <LF>   (repeated)
+//             kind K is a key value pair (one value per attribute),
+//             kind A an AVU added as is, kind S an AVU written with
+//             set (replacing all AVUs of the attribute)
+//             then the connection is closed
+//   or        BUSY <LF> when the queue is full
+// Fields are escaped with geoMetadata::appendEscaped. A client that
+// sends nothing for clientTimeout seconds is dropped.
+#include "geometadata.hpp"
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+
+
+class extractionDaemon {
+private:
+  int listenFd;
+  size_t maxQueued;
+  std::deque<int> queued;
+  std::mutex queueLock;
+  std::condition_variable queueReady;
+
+  void work();
+
+  void serve(int fd);
+
+  static const int clientTimeout;
+
+  static int readRequest(int fd, std::string &request);
+
+  static void writeAll(int fd, const std::string &data);
+
+public:
+  extractionDaemon(int in_listenFd, size_t in_maxQueued);
+
+  void run(int nWorkers);
+};
+
+extractionDaemon::extractionDaemon(int in_listenFd, size_t in_maxQueued) :
+  listenFd(in_listenFd), maxQueued(in_maxQueued) {
+
+}
+
+void extractionDaemon::run(int nWorkers) {
+
+  std::vector<std::thread> workers;
+
+  for(int t = 0; t < nWorkers; t++)
+    workers.push_back(std::thread(&extractionDaemon::work, this));
+
+  for(;;)
+    {
+      int fd = accept(listenFd, NULL, NULL);
+      if(fd < 0)
+	continue;
+
+      std::unique_lock<std::mutex> guard(queueLock);
+
+      //backpressure: the agent extracts in-process rather than wait
+      if(queued.size() >= maxQueued)
+	{
+	  guard.unlock();
+	  writeAll(fd, "BUSY\n");
+	  close(fd);
+	  continue;
+	}
+
+      queued.push_back(fd);
+      guard.unlock();
+      queueReady.notify_one();
+    }
+
+}
+
+void extractionDaemon::work() {
+
+  for(;;)
+    {
+      int fd;
+      {
+	std::unique_lock<std::mutex> guard(queueLock);
+	while(queued.empty())
+	  queueReady.wait(guard);
+	fd = queued.front();
+	queued.pop_front();
+      }
+
+      //an idle or stalled client must not hold a worker
+      struct timeval timeout;
+      timeout.tv_sec = clientTimeout;
+      timeout.tv_usec = 0;
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+      setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+
+      serve(fd);
+      close(fd);
+    }
+
+}
+
+int extractionDaemon::readRequest(int fd, std::string &request) {
+
+  char buf[4096];
+  ssize_t n;
+
+  //requests are a single short line and the client sends nothing
+  //after it, so whole reads can be taken
+  while(request.size() <= 8192 && (n = read(fd, buf, sizeof buf)) > 0)
+    {
+      request.append(buf, n);
+      size_t eol = request.find('\n');
+      if(eol != std::string::npos)
+	{
+	  request.erase(eol);
+	  return 0;
+	}
+    }
+
+  return -1;
+
+}
+
+void extractionDaemon::writeAll(int fd, const std::string &data) {
+
+  size_t written = 0;
+  ssize_t n;
+
+  while(written < data.size() && (n = write(fd, data.data() + written, data.size() - written)) > 0)
+    written += n;
+
+}
+
+void extractionDaemon::serve(int fd) {
+
+  std::string request;
+
+  if(readRequest(fd, request) < 0)
+    return;
+
+  size_t tab = request.find('\t');
+  if(tab == std::string::npos)
+    return;
+
+  std::string logPath = geoMetadata::unescape(request.substr(0, tab));
+  std::string phyPath = geoMetadata::unescape(request.substr(tab + 1));
+
+  ruleExecInfo_t rei;
+  std::vector<geoAVU> avus;
+  char status[32];
+
+  rei.status = 0;
+  rei.rsComm = NULL;
+
+  geoMetadata myGeoMetadata (&rei, logPath.c_str(), phyPath.c_str(), &avus, 0);
+  snprintf(status, sizeof status, "%d", myGeoMetadata.extractGeoMeta());
+
+  std::string response = "OK\t";
+  response += status;
+  response += "\t";
+  geoMetadata::appendEscaped(response, myGeoMetadata.logicalPath());
+  response += "\n";
+
+  for(size_t i = 0; i < avus.size(); i++)
+    {
+      response += avus[i].keyValue ? "K\t" : avus[i].replace ? "S\t" : "A\t";
+      geoMetadata::appendEscaped(response, avus[i].name);
+      response += "\t";
+      geoMetadata::appendEscaped(response, avus[i].value);
+      response += "\t";
+      geoMetadata::appendEscaped(response, avus[i].unit);
+      response += "\n";
+    }
+
+  writeAll(fd, response);
+
+}
+
+const int extractionDaemon::clientTimeout = 10;
+
+int main(int argc, char **argv) {
+
+  if(argc < 2 || argc > 4)
+    {
+      fprintf(stderr, "usage: %s <socket path> [workers] [queue depth]\n", argv[0]);
+      return 1;
+    }
+
+  int nWorkers = argc > 2 ? atoi(argv[2]) : (int) std::thread::hardware_concurrency();
+  size_t maxQueued = argc > 3 ? atoi(argv[3]) : 64;
+  struct sockaddr_un addr;
+
+  if(nWorkers < 1)
+    nWorkers = 1;
+
+  bzero(&addr, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  if(strlen(argv[1]) >= sizeof addr.sun_path)
+    {
+      fprintf(stderr, "socket path too long: %s\n", argv[1]);
+      return 1;
+    }
+  snprintf(addr.sun_path, sizeof addr.sun_path, "%s", argv[1]);
+
+  //agents that hang up early must not kill the daemon
+  signal(SIGPIPE, SIG_IGN);
+
+  //load drivers once, this is what the agents would otherwise repeat
+  GDALAllRegister();
+  OGRRegisterAll();
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(argv[1]);
+
+  //the daemon reads any path it is sent, so only the service account
+  //and its group may connect, whatever the umask
+  if(fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof addr) < 0 ||
+     chmod(argv[1], 0660) < 0 || listen(fd, 128) < 0)
+    {
+      perror("geometa_daemon");
+      return 1;
+    }
+
+  extractionDaemon daemon(fd, maxQueued);
+  daemon.run(nWorkers);
+
+  return 0;
+
+}
@@ -0,0 +1,384 @@
+// =-=-=-=-=-=-=-
+// geometa_fixtures: writes a generated corpus of geospatial files for
+// the stress and measurement targets of the Makefile.
+//
+//   geometa_fixtures <directory> stress|perf|compact|grow
+//
+// stress  16 directories of small tiled and striped GeoTIFFs,
+//         NetCDF-3 and NetCDF-4 files and point shapefiles, plus one
+//         directory of 64 GeoTIFFs, for many threads extracting at once
+// perf    one directory per measured case: tiny and huge, tiled and
+//         striped GeoTIFFs, NetCDF-3 and NetCDF-4 with 10, 1000 and
+//         10000 variables, shapefiles of 1000, 100000 and 10 million
+//         points. make perf keeps its stats per directory
+// compact NetCDF-3 and NetCDF-4 files with 10000 variables, for the
+//         catalog row check of netcdf=compact
+// grow    appends growRecords records to every NetCDF file below the
+//         directory, for measuring the append path
+//
+// Every file is georeferenced in EPSG:4326 and filled with a
+// deterministic pattern, so a rerun writes the same corpus.
+#include "geometadata.hpp"
+
+#include <cstdlib>
+
+
+//side of the huge GeoTIFFs, 256 MB each
+static const int hugeSize = 16384;
+
+//records appended to each NetCDF file by grow
+static const int growRecords = 2;
+
+//WKT of EPSG:4326, caller frees with CPLFree
+static char *geographicWkt() {
+
+  OGRSpatialReference srs;
+  char *wkt = NULL;
+
+  srs.importFromEPSG(4326);
+  srs.exportToWkt(&wkt);
+
+  return wkt;
+
+}
+
+//single band byte GeoTIFF over a 10 degree square, written row by row
+static int writeGeoTiff(const std::string &path, int size, int tiled) {
+
+  GDALDriver *driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+  char **options = NULL;
+
+  if(driver == NULL)
+    return -1;
+
+  if(tiled)
+    {
+      options = CSLSetNameValue(options, "TILED", "YES");
+      options = CSLSetNameValue(options, "BLOCKXSIZE", "256");
+      options = CSLSetNameValue(options, "BLOCKYSIZE", "256");
+    }
+
+  GDALDataset *dataset = driver->Create(path.c_str(), size, size, 1, GDT_Byte, options);
+  CSLDestroy(options);
+  if(dataset == NULL)
+    return -1;
+
+  double geoTransform[6] = { 0, 10.0 / size, 0, 50, 0, -10.0 / size };
+  char *wkt = geographicWkt();
+  dataset->SetGeoTransform(geoTransform);
+  dataset->SetProjection(wkt);
+  CPLFree(wkt);
+
+  std::vector<GByte> row(size);
+  CPLErr err = CE_None;
+  for(int y = 0; y < size && err == CE_None; y++)
+    {
+      for(int x = 0; x < size; x++)
+	row[x] = (GByte) ((x ^ y) & 0xff);
+      err = dataset->GetRasterBand(1)->RasterIO(GF_Write, 0, y, size, 1, &row[0], size, 1, GDT_Byte, 0, 0);
+    }
+
+  GDALClose((GDALDatasetH) dataset);
+
+  return err == CE_None ? 0 : -1;
+
+}
+
+//time, lat, lon grid with nVariables float variables and nRecords
+//records along the unlimited time dimension
+static int writeNetCDF(const std::string &path, int netcdf4, int nVariables, int gridSize, int nRecords) {
+
+  int ncid, status;
+  int dimids[3], timeId, latId, lonId;
+  std::vector<int> varids(nVariables);
+
+  status = nc_create(path.c_str(), NC_CLOBBER | (netcdf4 ? NC_NETCDF4 : 0), &ncid);
+  if(status != NC_NOERR)
+    return -1;
+
+  nc_def_dim(ncid, "time", NC_UNLIMITED, &dimids[0]);
+  nc_def_dim(ncid, "lat", gridSize, &dimids[1]);
+  nc_def_dim(ncid, "lon", gridSize, &dimids[2]);
+
+  nc_def_var(ncid, "time", NC_DOUBLE, 1, &dimids[0], &timeId);
+  nc_put_att_text(ncid, timeId, "units", 30, "days since 2000-01-01 00:00:00");
+  nc_def_var(ncid, "lat", NC_DOUBLE, 1, &dimids[1], &latId);
+  nc_put_att_text(ncid, latId, "units", 13, "degrees_north");
+  nc_def_var(ncid, "lon", NC_DOUBLE, 1, &dimids[2], &lonId);
+  nc_put_att_text(ncid, lonId, "units", 12, "degrees_east");
+
+  for(int v = 0; v < nVariables; v++)
+    {
+      char name[NC_MAX_NAME], longName[NC_MAX_NAME];
+      snprintf(name, sizeof name, "var%05d", v);
+      snprintf(longName, sizeof longName, "generated variable %d", v);
+      nc_def_var(ncid, name, NC_FLOAT, 3, dimids, &varids[v]);
+      nc_put_att_text(ncid, varids[v], "long_name", strlen(longName), longName);
+    }
+
+  nc_put_att_text(ncid, NC_GLOBAL, "title", 15, "geometa fixture");
+  nc_put_att_text(ncid, NC_GLOBAL, "Conventions", 6, "CF-1.6");
+
+  status = nc_enddef(ncid);
+
+  std::vector<double> axis(gridSize);
+  for(int i = 0; i < gridSize; i++)
+    axis[i] = 40 + 10.0 * i / gridSize;
+  nc_put_var_double(ncid, latId, &axis[0]);
+  nc_put_var_double(ncid, lonId, &axis[0]);
+
+  std::vector<float> grid(gridSize * gridSize);
+  for(int r = 0; r < nRecords && status == NC_NOERR; r++)
+    {
+      size_t start[3] = { (size_t) r, 0, 0 };
+      size_t count[3] = { 1, (size_t) gridSize, (size_t) gridSize };
+      double day = r;
+
+      status = nc_put_var1_double(ncid, timeId, start, &day);
+      for(int v = 0; v < nVariables && status == NC_NOERR; v++)
+	{
+	  for(size_t i = 0; i < grid.size(); i++)
+	    grid[i] = (float) ((i + v + r) % 100);
+	  status = nc_put_vara_float(ncid, varids[v], start, count, &grid[0]);
+	}
+    }
+
+  if(nc_close(ncid) != NC_NOERR)
+    status = -1;
+
+  return status == NC_NOERR ? 0 : -1;
+
+}
+
+//point layer of nFeatures points on a grid, with .shx, .dbf and .prj
+static int writeShapefile(const std::string &path, long nFeatures) {
+
+  OGRSFDriver *driver = OGRSFDriverRegistrar::GetRegistrar()->GetDriverByName("ESRI Shapefile");
+  if(driver == NULL)
+    return -1;
+
+  OGRDataSource *ds = driver->CreateDataSource(path.c_str(), NULL);
+  if(ds == NULL)
+    return -1;
+
+  OGRSpatialReference srs;
+  srs.importFromEPSG(4326);
+
+  std::string layerName = boost::filesystem::path(path).stem().string();
+  OGRLayer *layer = ds->CreateLayer(layerName.c_str(), &srs, wkbPoint, NULL);
+  if(layer == NULL)
+    {
+      OGRDataSource::DestroyDataSource(ds);
+      return -1;
+    }
+
+  OGRFieldDefn idField("id", OFTInteger);
+  layer->CreateField(&idField);
+
+  long side = (long) std::ceil(std::sqrt((double) nFeatures));
+  OGRErr err = OGRERR_NONE;
+  for(long i = 0; i < nFeatures && err == OGRERR_NONE; i++)
+    {
+      OGRFeature *feature = OGRFeature::CreateFeature(layer->GetLayerDefn());
+      OGRPoint point(-120 + 10.0 * (i % side) / side, 30 + 10.0 * (i / side) / side);
+
+      feature->SetField("id", (int) i);
+      feature->SetGeometry(&point);
+      err = layer->CreateFeature(feature);
+      OGRFeature::DestroyFeature(feature);
+    }
+
+  OGRDataSource::DestroyDataSource(ds);
+
+  return err == OGRERR_NONE ? 0 : -1;
+
+}
+
+//appends nRecords records to every variable on the unlimited
+//dimension, the time coordinate continues where it stopped
+static int growNetCDF(const std::string &path, int nRecords) {
+
+  int ncid, nVariables, unlimdimid;
+  size_t length;
+
+  if(nc_open(path.c_str(), NC_WRITE, &ncid) != NC_NOERR)
+    return -1;
+
+  if(nc_inq_nvars(ncid, &nVariables) != NC_NOERR ||
+     nc_inq_unlimdim(ncid, &unlimdimid) != NC_NOERR || unlimdimid < 0 ||
+     nc_inq_dimlen(ncid, unlimdimid, &length) != NC_NOERR)
+    {
+      nc_close(ncid);
+      return -1;
+    }
+
+  int status = NC_NOERR;
+  for(int v = 0; v < nVariables && status == NC_NOERR; v++)
+    {
+      int nDims, dimids[NC_MAX_VAR_DIMS];
+      size_t start[NC_MAX_VAR_DIMS], count[NC_MAX_VAR_DIMS];
+      size_t nValues = nRecords;
+
+      nc_inq_varndims(ncid, v, &nDims);
+      nc_inq_vardimid(ncid, v, dimids);
+      if(nDims == 0 || dimids[0] != unlimdimid)
+	continue;
+
+      start[0] = length;
+      count[0] = nRecords;
+      for(int d = 1; d < nDims; d++)
+	{
+	  start[d] = 0;
+	  nc_inq_dimlen(ncid, dimids[d], &count[d]);
+	  nValues *= count[d];
+	}
+
+      std::vector<double> values(nValues);
+      for(size_t i = 0; i < nValues; i++)
+	values[i] = nDims == 1 ? length + i : (double) ((i + v) % 100);
+      status = nc_put_vara_double(ncid, v, start, count, &values[0]);
+    }
+
+  if(nc_close(ncid) != NC_NOERR)
+    status = -1;
+
+  return status == NC_NOERR ? 0 : -1;
+
+}
+
+static int writeStressCorpus(const std::string &root) {
+
+  int status = 0;
+
+  for(int d = 0; d < 16 && status == 0; d++)
+    {
+      char name[16];
+      snprintf(name, sizeof name, "/d%02d", d);
+      std::string dir = root + name;
+
+      boost::filesystem::create_directories(dir);
+      status |= writeGeoTiff(dir + "/tiled.tif", 512, 1);
+      status |= writeGeoTiff(dir + "/striped.tif", 512, 0);
+      status |= writeNetCDF(dir + "/classic.nc", 0, 10, 32, 4);
+      status |= writeNetCDF(dir + "/nc4.nc", 1, 10, 32, 4);
+      status |= writeShapefile(dir + "/points.shp", 1000);
+    }
+
+  //one wide directory, its files are spread over all walkers
+  boost::filesystem::create_directories(root + "/flat");
+  for(int f = 0; f < 64 && status == 0; f++)
+    {
+      char name[32];
+      snprintf(name, sizeof name, "/flat/tile%02d.tif", f);
+      status |= writeGeoTiff(root + name, 256, f % 2);
+    }
+
+  return status;
+
+}
+
+static int writePerfCorpus(const std::string &root) {
+
+  int status = 0;
+  const char *dirs[] = { "geotiff_tiny_tiled", "geotiff_tiny_striped", "geotiff_huge_tiled", "geotiff_huge_striped",
+			 "netcdf3_10", "netcdf3_1000", "netcdf3_10000", "netcdf4_10", "netcdf4_1000", "netcdf4_10000",
+			 "shapefile_1k", "shapefile_100k", "shapefile_10m" };
+
+  for(size_t d = 0; d < sizeof dirs / sizeof dirs[0]; d++)
+    boost::filesystem::create_directories(root + "/" + dirs[d]);
+
+  //tiny files are many, so their p99 is not a single sample
+  for(int f = 0; f < 20 && status == 0; f++)
+    {
+      char name[32];
+      snprintf(name, sizeof name, "/tile%02d.tif", f);
+      status |= writeGeoTiff(root + "/geotiff_tiny_tiled" + name, 256, 1);
+      status |= writeGeoTiff(root + "/geotiff_tiny_striped" + name, 256, 0);
+    }
+
+  status |= writeGeoTiff(root + "/geotiff_huge_tiled/huge.tif", hugeSize, 1);
+  status |= writeGeoTiff(root + "/geotiff_huge_striped/huge.tif", hugeSize, 0);
+
+  for(int f = 0; f < 5 && status == 0; f++)
+    {
+      char name[32];
+      snprintf(name, sizeof name, "/grid%d.nc", f);
+      status |= writeNetCDF(root + "/netcdf3_10" + name, 0, 10, 64, 4);
+      status |= writeNetCDF(root + "/netcdf4_10" + name, 1, 10, 64, 4);
+    }
+
+  status |= writeNetCDF(root + "/netcdf3_1000/grid.nc", 0, 1000, 16, 4);
+  status |= writeNetCDF(root + "/netcdf4_1000/grid.nc", 1, 1000, 16, 4);
+  status |= writeNetCDF(root + "/netcdf3_10000/grid.nc", 0, 10000, 16, 4);
+  status |= writeNetCDF(root + "/netcdf4_10000/grid.nc", 1, 10000, 16, 4);
+
+  status |= writeShapefile(root + "/shapefile_1k/points.shp", 1000);
+  status |= writeShapefile(root + "/shapefile_100k/points.shp", 100000);
+  status |= writeShapefile(root + "/shapefile_10m/points.shp", 10000000);
+
+  return status;
+
+}
+
+static int writeCompactCorpus(const std::string &root) {
+
+  int status = 0;
+
+  status |= writeNetCDF(root + "/classic.nc", 0, 10000, 16, 4);
+  status |= writeNetCDF(root + "/nc4.nc", 1, 10000, 16, 4);
+
+  return status;
+
+}
+
+static int growCorpus(const std::string &root) {
+
+  boost::system::error_code ec;
+  boost::filesystem::recursive_directory_iterator it(root, ec), end;
+  int status = 0;
+
+  for(; !ec && it != end; it.increment(ec))
+    if(boost::filesystem::is_regular_file(it->status()) && it->path().extension() == ".nc")
+      status |= growNetCDF(it->path().string(), growRecords);
+
+  return ec ? -1 : status;
+
+}
+
+int main(int argc, char **argv) {
+
+  int status;
+
+  if(argc != 3 ||
+     (strcmp(argv[2], "stress") != 0 && strcmp(argv[2], "perf") != 0 &&
+      strcmp(argv[2], "compact") != 0 && strcmp(argv[2], "grow") != 0))
+    {
+      fprintf(stderr, "usage: %s <directory> stress|perf|compact|grow\n", argv[0]);
+      return 1;
+    }
+
+  GDALAllRegister();
+  OGRRegisterAll();
+
+  if(strcmp(argv[2], "grow") == 0)
+    status = growCorpus(argv[1]);
+  else
+    {
+      boost::filesystem::create_directories(argv[1]);
+      if(strcmp(argv[2], "stress") == 0)
+	status = writeStressCorpus(argv[1]);
+      else if(strcmp(argv[2], "compact") == 0)
+	status = writeCompactCorpus(argv[1]);
+      else
+	status = writePerfCorpus(argv[1]);
+    }
+
+  if(status != 0)
+    {
+      fprintf(stderr, "cannot write the corpus below %s\n", argv[1]);
+      return 1;
+    }
+
+  return 0;
+
+}
@@ -0,0 +1,635 @@
+// =-=-=-=-=-=-=-
+// geometa_scan: offline backfill of geospatial metadata for an
+// existing vault. Walks the vault directory tree on all cores, runs
+// the geoMetadata extraction on every supported file and writes a
+// bulk-load file of tab separated
+//   logical path, attribute, value, unit
+// lines. Completed directories are appended to an optional checkpoint
+// file so an interrupted scan can be resumed. Directories are listed
+// and their files extracted as separate work items, so one huge
+// directory is spread over all walkers.
+//
+// With --stats the scan also records, per file extension (or per
+// directory with --stats-key dir), the extraction latency and catalog
+// requests of every file, and the peak RSS of the run. --baseline
+// compares them against the stats of an earlier run over the same
+// reference files and exits with status 2 when any of them grew by
+// more than --threshold percent.
+//
+// With --catalog the files are extracted against a recordingCatalog
+// loaded from an earlier output file, so re-extraction, NetCDF appends
+// and quicklooks run as in an agent, and the output holds the
+// recorded metadata of every scanned file.
+#include "geometadata.hpp"
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <condition_variable>
+#include <set>
+#include <cstdlib>
+#include <chrono>
+#include <sys/resource.h>
+
+
+//a listed directory whose files are being extracted. The walker
+//finishing its last file writes the rows and checkpoints it
+struct directoryJob {
+  std::string dir;
+  std::atomic<long> remaining;
+  std::mutex lock;
+  std::string lines;
+};
+
+//a directory to list, or one file of a listed directory
+struct scanItem {
+  std::string phyPath;
+  std::string logPath;
+  int sidecarsChecked;
+  int repeats;
+  std::shared_ptr<directoryJob> job;   //NULL for a directory
+};
+
+//work queue of one walker thread. The owner takes work from the
+//back, idle walkers steal the oldest (shallowest) entries from the
+//front, which tend to carry the largest subtrees
+struct walkerQueue {
+  std::mutex lock;
+  std::deque<scanItem> items;
+};
+
+//latency and catalog requests of the files of one extension
+struct formatStats {
+  std::vector<double> millis;
+  long catalogCalls;
+
+  formatStats() : catalogCalls(0) {}
+};
+
+//one stats or baseline line, p99 latency and catalog requests per file
+struct statsLine {
+  double p99;
+  double callsPerFile;
+};
+
+class vaultScanner {
+private:
+  std::string vaultRoot;
+  std::string logicalRoot;
+  FILE *output;
+  FILE *checkpoint;
+  std::set<std::string> completed;
+  std::vector<walkerQueue> queues;
+  std::atomic<long> pending;
+  long queued;
+  std::mutex idleLock;
+  std::condition_variable idleReady;
+  std::atomic<long> nFiles;
+  std::atomic<long> nAVUs;
+  std::mutex outputLock;
+  std::map<std::string, formatStats> stats;
+  std::mutex statsLock;
+  recordingCatalog *catalog;
+  int byDirectory;
+  int minSamples;
+
+  void push(int t, const scanItem &item);
+
+  int take(int t, scanItem &item);
+
+  void walk(int t);
+
+  void scanDirectory(int t, const std::string &dir);
+
+  void finishDirectory(directoryJob &job);
+
+  void extractFile(const std::string &phyPath, const std::string &logPath,
+		   int sidecarsChecked, int repeats, std::string &lines);
+
+public:
+  vaultScanner(const char *in_vaultRoot, const char *in_logicalRoot,
+	       FILE *in_output, FILE *in_checkpoint, const std::set<std::string> &in_completed,
+	       int nThreads);
+
+  void run();
+
+  long fileCount() { return nFiles; }
+
+  long avuCount() { return nAVUs; }
+
+  //extract against in_catalog instead of collecting the metadata
+  void recordInto(recordingCatalog *in_catalog) { catalog = in_catalog; }
+
+  //stats per directory below the vault rather than per extension
+  void statsByDirectory() { byDirectory = 1; }
+
+  //extract the files of a directory repeatedly until it has at least n samples
+  void sampleAtLeast(int n) { minSamples = n; }
+
+  void writeStats(FILE *fp);
+};
+
+vaultScanner::vaultScanner(const char *in_vaultRoot, const char *in_logicalRoot,
+			   FILE *in_output, FILE *in_checkpoint, const std::set<std::string> &in_completed,
+			   int nThreads) :
+  vaultRoot(in_vaultRoot), logicalRoot(in_logicalRoot), output(in_output),
+  checkpoint(in_checkpoint), completed(in_completed), queues(nThreads),
+  pending(0), queued(0), nFiles(0), nAVUs(0), catalog(NULL), byDirectory(0), minSamples(1) {
+
+  //no trailing separators, logical paths are built by concatenation
+  while(vaultRoot.size() > 1 && vaultRoot[vaultRoot.size() - 1] == '/')
+    vaultRoot.erase(vaultRoot.size() - 1);
+  while(logicalRoot.size() > 1 && logicalRoot[logicalRoot.size() - 1] == '/')
+    logicalRoot.erase(logicalRoot.size() - 1);
+
+}
+
+void vaultScanner::push(int t, const scanItem &item) {
+
+  //counted before it is visible so walkers never see zero early
+  pending++;
+
+  {
+    std::lock_guard<std::mutex> guard(queues[t].lock);
+    queues[t].items.push_back(item);
+  }
+
+  std::lock_guard<std::mutex> guard(idleLock);
+  queued++;
+  idleReady.notify_one();
+
+}
+
+int vaultScanner::take(int t, scanItem &item) {
+
+  int found = 0;
+
+  {
+    std::lock_guard<std::mutex> guard(queues[t].lock);
+    if(!queues[t].items.empty())
+      {
+	item = queues[t].items.back();
+	queues[t].items.pop_back();
+	found = 1;
+      }
+  }
+
+  for(size_t i = 1; !found && i < queues.size(); i++)
+    {
+      walkerQueue &victim = queues[(t + i) % queues.size()];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if(!victim.items.empty())
+	{
+	  item = victim.items.front();
+	  victim.items.pop_front();
+	  found = 1;
+	}
+    }
+
+  if(found)
+    {
+      std::lock_guard<std::mutex> guard(idleLock);
+      queued--;
+    }
+
+  return found;
+
+}
+
+void vaultScanner::walk(int t) {
+
+  scanItem item;
+
+  while(true)
+    {
+      if(!take(t, item))
+	{
+	  //idle walkers sleep until work is queued or the scan is over
+	  std::unique_lock<std::mutex> guard(idleLock);
+	  idleReady.wait(guard, [this] { return queued > 0 || pending == 0; });
+	  if(queued == 0)
+	    break;
+	  continue;
+	}
+
+      if(item.job == NULL)
+	scanDirectory(t, item.phyPath);
+      else
+	{
+	  std::string lines;
+	  extractFile(item.phyPath, item.logPath, item.sidecarsChecked, item.repeats, lines);
+
+	  {
+	    std::lock_guard<std::mutex> guard(item.job->lock);
+	    item.job->lines += lines;
+	  }
+
+	  if(--item.job->remaining == 0)
+	    finishDirectory(*item.job);
+	}
+
+      //the lock orders the wakeup after a sleeper's predicate check
+      if(--pending == 0)
+	{
+	  std::lock_guard<std::mutex> guard(idleLock);
+	  idleReady.notify_all();
+	}
+    }
+
+}
+
+void vaultScanner::run() {
+
+  std::vector<std::thread> walkers;
+  scanItem root;
+
+  root.phyPath = vaultRoot;
+  root.sidecarsChecked = 0;
+  root.repeats = 1;
+  push(0, root);
+
+  for(size_t t = 0; t < queues.size(); t++)
+    walkers.push_back(std::thread(&vaultScanner::walk, this, (int)t));
+
+  for(size_t t = 0; t < walkers.size(); t++)
+    walkers[t].join();
+
+}
+
+void vaultScanner::scanDirectory(int t, const std::string &dir) {
+
+  boost::system::error_code ec;
+  boost::filesystem::directory_iterator it(dir, ec), end;
+  std::set<std::string> names;
+  std::vector<scanItem> files;
+  scanItem item;
+
+  item.sidecarsChecked = 0;
+  item.repeats = 1;
+
+  //one listing per directory answers every sidecar question,
+  //no per-file existence probes are needed
+  for(; !ec && it != end; it.increment(ec))
+    {
+      boost::filesystem::file_status status = it->symlink_status(ec);
+      if(ec)
+	break;
+
+      if(boost::filesystem::is_directory(status))
+	{
+	  item.phyPath = it->path().string();
+	  push(t, item);
+	}
+      else if(boost::filesystem::is_regular_file(status))
+	names.insert(it->path().filename().string());
+    }
+
+  if(ec)
+    rodsLog(LOG_ERROR, "geometa_scan: cannot list %s: %s", dir.c_str(), ec.message().c_str());
+
+  //finished in an earlier run, only its subdirectories are revisited
+  if(completed.count(dir))
+    return;
+
+  std::shared_ptr<directoryJob> job(new directoryJob);
+  std::string logicalDir = logicalRoot + dir.substr(vaultRoot.size());
+
+  job->dir = dir;
+  item.job = job;
+
+  for(std::set<std::string>::iterator name = names.begin(); name != names.end(); ++name)
+    {
+      boost::filesystem::path file(*name);
+      std::string ext = file.extension().string();
+
+      if(geoMetadata::extensionType(ext) == 0)
+	continue;
+
+      //a shapefile is extracted once, from its .shp, and only when
+      //the other required parts sit next to it
+      item.sidecarsChecked = 0;
+      if(geoMetadata::shapefilePart(ext))
+	{
+	  std::string stem = file.stem().string();
+	  if(ext != ".shp" ||
+	     !names.count(stem + ".shx") || !names.count(stem + ".dbf") || !names.count(stem + ".prj"))
+	    continue;
+	  item.sidecarsChecked = 1;
+	}
+
+      item.phyPath = dir + "/" + *name;
+      item.logPath = logicalDir + "/" + *name;
+      files.push_back(item);
+    }
+
+  //directories of few files repeat them up to the sample count
+  if(!files.empty() && files.size() < (size_t) minSamples)
+    for(size_t i = 0; i < files.size(); i++)
+      files[i].repeats = (minSamples + files.size() - 1) / files.size();
+
+  //the count is complete before any file can finish
+  job->remaining = files.size();
+
+  if(files.empty())
+    finishDirectory(*job);
+
+  for(size_t i = 0; i < files.size(); i++)
+    push(t, files[i]);
+
+}
+
+void vaultScanner::finishDirectory(directoryJob &job) {
+
+  //rows of a directory are on disk before it is checkpointed
+  std::lock_guard<std::mutex> guard(outputLock);
+  fwrite(job.lines.data(), 1, job.lines.size(), output);
+  fflush(output);
+  if(checkpoint != NULL)
+    {
+      fprintf(checkpoint, "%s\n", job.dir.c_str());
+      fflush(checkpoint);
+    }
+
+}
+
+void vaultScanner::extractFile(const std::string &phyPath, const std::string &logPath,
+			       int sidecarsChecked, int repeats, std::string &lines) {
+
+  std::vector<geoAVU> avus, before;
+  boost::filesystem::path file(phyPath);
+  std::string key = file.extension().string();
+
+  //the directory relative to the vault, "." for the vault itself
+  if(byDirectory)
+    {
+      key = file.parent_path().string().substr(vaultRoot.size());
+      key = key.empty() ? "." : key.substr(1);
+    }
+
+  //every repetition starts from the catalog state of the first
+  if(catalog != NULL && repeats > 1)
+    catalog->query(logPath, std::set<std::string>(), before);
+
+  for(int r = 0; r < repeats; r++)
+    {
+      ruleExecInfo_t rei;
+
+      rei.status = 0;
+      rei.rsComm = NULL;
+      avus.clear();
+      if(r > 0 && catalog != NULL)
+	catalog->restore(logPath, before);
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+      std::unique_ptr<geoMetadata> myGeoMetadata (catalog != NULL ?
+	new geoMetadata (&rei, logPath.c_str(), phyPath.c_str(), catalog, sidecarsChecked) :
+	new geoMetadata (&rei, logPath.c_str(), phyPath.c_str(), &avus, sidecarsChecked));
+
+      if(myGeoMetadata->extractGeoMeta() < 0)
+	{
+	  rodsLog(LOG_ERROR, "geometa_scan: extraction failed for %s", phyPath.c_str());
+	  return;
+	}
+
+      double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+      std::lock_guard<std::mutex> guard(statsLock);
+      stats[key].millis.push_back(millis);
+      stats[key].catalogCalls += myGeoMetadata->catalogCallCount();
+    }
+
+  //everything the catalog now holds for the file, not only this run's writes
+  if(catalog != NULL)
+    catalog->query(logPath, std::set<std::string>(), avus);
+
+  for(size_t i = 0; i < avus.size(); i++)
+    {
+      geoMetadata::appendEscaped(lines, logPath);
+      lines += "\t";
+      geoMetadata::appendEscaped(lines, avus[i].name);
+      lines += "\t";
+      geoMetadata::appendEscaped(lines, avus[i].value);
+      lines += "\t";
+      geoMetadata::appendEscaped(lines, avus[i].unit);
+      lines += "\n";
+    }
+
+  nFiles++;
+  nAVUs += avus.size();
+
+}
+
+void vaultScanner::writeStats(FILE *fp) {
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  //extension or directory, samples, p50, p99 and max milliseconds,
+  //catalog requests per sample
+  for(std::map<std::string, formatStats>::iterator it = stats.begin(); it != stats.end(); ++it)
+    {
+      std::vector<double> &millis = it->second.millis;
+      std::sort(millis.begin(), millis.end());
+      size_t n = millis.size();
+
+      fprintf(fp, "%s\t%zu\t%.3f\t%.3f\t%.3f\t%.2f\n", it->first.c_str(), n,
+	      millis[(n - 1) / 2], millis[(size_t) std::ceil(0.99 * n) - 1], millis[n - 1],
+	      (double) it->second.catalogCalls / n);
+    }
+
+  //ru_maxrss is in kilobytes on Linux
+  fprintf(fp, "peak_rss_kb\t%ld\n", usage.ru_maxrss);
+
+}
+
+//extension -> p99 and catalog requests per file, peak_rss_kb -> p99
+static std::map<std::string, statsLine> readStats(const char *path) {
+
+  std::map<std::string, statsLine> lines;
+  std::ifstream in(path);
+  std::string line;
+
+  while(std::getline(in, line))
+    {
+      char key[256];
+      long files;
+      double p50, p99, max, calls;
+
+      if(sscanf(line.c_str(), "%255s %ld %lf %lf %lf %lf", key, &files, &p50, &p99, &max, &calls) == 6)
+	{
+	  lines[key].p99 = p99;
+	  lines[key].callsPerFile = calls;
+	}
+      else if(sscanf(line.c_str(), "peak_rss_kb %lf", &p99) == 1)
+	{
+	  lines["peak_rss_kb"].p99 = p99;
+	  lines["peak_rss_kb"].callsPerFile = 0;
+	}
+    }
+
+  return lines;
+
+}
+
+//reports every value that grew by more than threshold percent over
+//the baseline, formats missing on either side are not compared
+static int compareStats(const char *statsPath, const char *baselinePath, double threshold) {
+
+  std::map<std::string, statsLine> current = readStats(statsPath);
+  std::map<std::string, statsLine> baseline = readStats(baselinePath);
+  double limit = 1.0 + threshold / 100.0;
+  int regressions = 0;
+
+  if(baseline.empty())
+    {
+      fprintf(stderr, "cannot read baseline %s\n", baselinePath);
+      return -1;
+    }
+
+  for(std::map<std::string, statsLine>::iterator it = baseline.begin(); it != baseline.end(); ++it)
+    {
+      std::map<std::string, statsLine>::iterator now = current.find(it->first);
+      if(now == current.end())
+	continue;
+
+      const char *what = it->first == "peak_rss_kb" ? "peak RSS (kB)" : "p99 latency (ms)";
+      if(now->second.p99 > it->second.p99 * limit)
+	{
+	  fprintf(stderr, "regression %s: %s %.3f, baseline %.3f\n", it->first.c_str(), what, now->second.p99, it->second.p99);
+	  regressions++;
+	}
+      if(now->second.callsPerFile > it->second.callsPerFile * limit)
+	{
+	  fprintf(stderr, "regression %s: catalog requests per file %.2f, baseline %.2f\n", it->first.c_str(), now->second.callsPerFile, it->second.callsPerFile);
+	  regressions++;
+	}
+    }
+
+  return regressions;
+
+}
+
+int main(int argc, char **argv) {
+
+  const char *statsPath = NULL;
+  const char *baselinePath = NULL;
+  const char *catalogPath = NULL;
+  int byDirectory = 0;
+  int minSamples = 1;
+  double threshold = 20;
+  int nThreads = std::thread::hardware_concurrency();
+
+  //leading options, then the positional arguments
+  while(argc > 2 && strncmp(argv[1], "--", 2) == 0)
+    {
+      if(strcmp(argv[1], "--stats") == 0)
+	statsPath = argv[2];
+      else if(strcmp(argv[1], "--baseline") == 0)
+	baselinePath = argv[2];
+      else if(strcmp(argv[1], "--threshold") == 0)
+	threshold = atof(argv[2]);
+      else if(strcmp(argv[1], "--threads") == 0)
+	nThreads = atoi(argv[2]);
+      else if(strcmp(argv[1], "--min-samples") == 0)
+	minSamples = atoi(argv[2]);
+      else if(strcmp(argv[1], "--catalog") == 0)
+	catalogPath = argv[2];
+      else if(strcmp(argv[1], "--stats-key") == 0 && strcmp(argv[2], "dir") == 0)
+	byDirectory = 1;
+      else if(strcmp(argv[1], "--stats-key") == 0 && strcmp(argv[2], "ext") == 0)
+	byDirectory = 0;
+      else
+	break;
+      argc -= 2;
+      argv += 2;
+    }
+
+  if(argc < 4 || argc > 5 || (baselinePath != NULL && statsPath == NULL))
+    {
+      fprintf(stderr, "usage: %s [--threads n] [--catalog file]\n"
+	      "       [--stats file [--stats-key ext|dir] [--min-samples n] [--baseline file] [--threshold percent]]\n"
+	      "       <vault directory> <logical collection> <output file> [checkpoint file]\n", argv[0]);
+      return 1;
+    }
+
+  std::set<std::string> completed;
+  FILE *checkpoint = NULL;
+
+  //resume: skip directories listed by the previous run
+  if(argc == 5)
+    {
+      std::ifstream previous(argv[4]);
+      std::string line;
+      while(std::getline(previous, line))
+	completed.insert(line);
+
+      checkpoint = fopen(argv[4], "a");
+      if(checkpoint == NULL)
+	{
+	  fprintf(stderr, "cannot open checkpoint file %s\n", argv[4]);
+	  return 1;
+	}
+    }
+
+  //an earlier output file, the state the extractions start from
+  recordingCatalog catalog;
+  if(catalogPath != NULL && boost::filesystem::exists(catalogPath) && catalog.load(catalogPath) < 0)
+    {
+      fprintf(stderr, "cannot read catalog file %s\n", catalogPath);
+      return 1;
+    }
+
+  FILE *output = fopen(argv[3], completed.empty() ? "w" : "a");
+  if(output == NULL)
+    {
+      fprintf(stderr, "cannot open output file %s\n", argv[3]);
+      return 1;
+    }
+
+  //driver registration is not safe to race, do it before any walker starts
+  GDALAllRegister();
+  OGRRegisterAll();
+
+  if(nThreads < 1)
+    nThreads = 1;
+
+  vaultScanner scanner(argv[1], argv[2], output, checkpoint, completed, nThreads);
+  if(catalogPath != NULL)
+    scanner.recordInto(&catalog);
+  if(byDirectory)
+    scanner.statsByDirectory();
+  if(minSamples > 1)
+    scanner.sampleAtLeast(minSamples);
+  scanner.run();
+
+  fprintf(stderr, "%ld files, %ld AVUs\n", scanner.fileCount(), scanner.avuCount());
+
+  fclose(output);
+  if(checkpoint != NULL)
+    fclose(checkpoint);
+
+  if(statsPath != NULL)
+    {
+      FILE *statsFile = fopen(statsPath, "w");
+      if(statsFile == NULL)
+	{
+	  fprintf(stderr, "cannot open stats file %s\n", statsPath);
+	  return 1;
+	}
+      scanner.writeStats(statsFile);
+      fclose(statsFile);
+    }
+
+  if(baselinePath != NULL)
+    {
+      int regressions = compareStats(statsPath, baselinePath, threshold);
+      if(regressions < 0)
+	return 1;
+      if(regressions > 0)
+	return 2;
+    }
+
+  return 0;
+
+}
@@ -1,8 +1,44 @@
 #include "geometadata.hpp"
 
-geoMetadata::geoMetadata( ruleExecInfo_t *in_rei, char *logPath, char *phyPath ) {
+//opens a vector source read only; GML is opened with WRITE_GFS=NO so the
+//driver does not leave a .gfs schema file next to the object in the vault
+static OGRDataSource *openVectorSource(const char *path) {
+#if GDAL_VERSION_NUM >= 2000000
+  const char *ext = strrchr(path, '.');
+
+  if(ext != NULL && strcasecmp(ext, ".gml") == 0)
+    {
+      const char *openOptions[] = { "WRITE_GFS=NO", NULL };
+
+      return (OGRDataSource *) GDALOpenEx(path, GDAL_OF_VECTOR | GDAL_OF_READONLY, NULL, openOptions, NULL);
+    }
+#endif
+  return (OGRDataSource *) OGRSFDriverRegistrar::Open(path, FALSE);
+}
+
+geoMetadata::geoMetadata( ruleExecInfo_t *in_rei, char *logPath, char *phyPath ) :
+  geoMetadata( in_rei, logPath, phyPath, (std::vector<geoAVU> *) NULL, 0 ) {
+
+}
+
+geoMetadata::geoMetadata( ruleExecInfo_t *in_rei, const char *logPath, const char *phyPath,
+			  recordingCatalog *in_catalog, int in_sidecarsChecked ) :
+  geoMetadata( in_rei, logPath, phyPath, (std::vector<geoAVU> *) NULL, in_sidecarsChecked ) {
+
+  //catalog requests are recorded there instead of sent to iRODS
+  catalog = in_catalog;
+
+}
+
+geoMetadata::geoMetadata( ruleExecInfo_t *in_rei, const char *logPath, const char *phyPath,
+			  std::vector<geoAVU> *in_sink, int in_sidecarsChecked ) {
   rei = in_rei;
   
+  //when set, extracted metadata is collected here instead of
+  //being written to the iRODS catalog
+  sink = in_sink;
+  catalog = NULL;
+  
   //-d since we are setting metadata for a file
   snprintf(objType, sizeof objType, "-d");
   
@@ -21,9 +57,24 @@ geoMetadata::geoMetadata( ruleExecInfo_t *in_rei, char *logPath, char *phyPath )
   setGeoExtension();
 
   //set type code based on geospatial file's type
-  //1 = raster, 2 = vector
+  //1 = raster, 2 = vector, 3 = archive
   geoType = geospatialType();
 
+  poDataset = NULL;
+  poDS = NULL;
+  sidecarsChecked = in_sidecarsChecked;
+  opened = 0;
+  catalogCalls = 0;
+  archiveMember = 0;
+  
+}
+
+void geoMetadata::openDatasets() {
+
+  if(opened)
+    return;
+  opened = 1;
+
   //initialize the dataset corresponding to geospatial file type
   if(geoType == 1) //raster
     {
@@ -37,9 +88,14 @@ geoMetadata::geoMetadata( ruleExecInfo_t *in_rei, char *logPath, char *phyPath )
       //register all vector format drivers
       OGRRegisterAll();
       
+      //single file vector formats (geopackage, gml) can be opened directly
+      if(!shapefilePart(geoExt))
+	{
+	  poDS = openVectorSource(filePath);
+	}
       //we need to make sure that the bare minimum of related files are present
       //if so, modify objName and filePath to point to shapefile instead
-      if(shapefileComplete())
+      else if(sidecarsChecked || shapefileComplete())
 	{
 	  poDS = (OGRDataSource *) OGRSFDriverRegistrar::Open ( filePath, FALSE);
 	}
@@ -48,26 +104,345 @@ geoMetadata::geoMetadata( ruleExecInfo_t *in_rei, char *logPath, char *phyPath )
 	  poDS = NULL;
 	}
     }
+  else if (geoType == 3)  //archive
+    {
+      //members are opened one by one during extraction
+      GDALAllRegister();
+      OGRRegisterAll();
+    }
   
 }
 
 geoMetadata::~geoMetadata() {
 
+  if(poDS != NULL)
+    OGRDataSource::DestroyDataSource(poDS);
+
+  if(poDataset != NULL)
+    GDALClose((GDALDatasetH) poDataset);
+
 }
 
-void geoMetadata::setGeoExtension() {
+int geoMetadata::workerCount(int nItems) {
+
+  int nThreads = std::thread::hardware_concurrency();
+
+  if(nThreads < 1)
+    nThreads = 1;
+  if(nThreads > maxThreads)
+    nThreads = maxThreads;
+  if(nThreads > nItems)
+    nThreads = nItems;
+
+  return nThreads;
+
+}
 
-  msParam_t msLogPath, parentPath, childName;
-  char logPath[512], fileName[256];
+void geoMetadata::runWorkers(int nItems, const std::function<void(int, int)> &fn) {
 
-  snprintf(logPath, sizeof logPath, "%s", objName);
-  fillStrInMsParam(&msLogPath,logPath);
+  int nThreads = workerCount(nItems);
+  std::atomic<int> nextItem(0);
   
-  msiSplitPath(&msLogPath,&parentPath,&childName,rei);
+  if(nThreads <= 1)
+    {
+      for(int i = 0; i < nItems; i++)
+	fn(i, 0);
+      return;
+    }
   
-  snprintf(fileName, sizeof fileName, "%s", ((char *)childName.inOutStruct));
+  //items are pulled off a shared counter, fn only writes to its own item
+  std::vector<std::thread> workers;
+  for(int t = 0; t < nThreads; t++)
+    workers.push_back(std::thread([&fn, &nextItem, nItems, t]() {
+	  int i;
+	  while((i = nextItem++) < nItems)
+	    fn(i, t);
+	}));
+  
+  for(size_t t = 0; t < workers.size(); t++)
+    workers[t].join();
+
+}
+
+const size_t geoContext::maxHandles = 4;
+
+geoContext &geoContext::current() {
+
+  //created on first use in each thread, closed when the thread exits
+  static thread_local geoContext context;
+
+  return context;
+
+}
+
+geoContext::~geoContext() {
+
+  release();
+
+  std::map<std::string, OGRCoordinateTransformation *>::iterator it;
+  for(it = wgs84.begin(); it != wgs84.end(); ++it)
+    if(it->second != NULL)
+      OGRCoordinateTransformation::DestroyCT(it->second);
+
+}
+
+void geoContext::close(cachedHandle &handle) {
+
+  if(handle.vector != NULL)
+    OGRDataSource::DestroyDataSource(handle.vector);
+  if(handle.raster != NULL)
+    GDALClose((GDALDatasetH) handle.raster);
+
+}
+
+void geoContext::release() {
+
+  for(size_t i = 0; i < handles.size(); i++)
+    close(handles[i]);
+  handles.clear();
+
+}
+
+void *geoContext::open(const char *path, int isVector) {
+
+  VSIStatBufL sStat;
+  long long size = -1, mtime = -1;
+
+  if(VSIStatL(path, &sStat) == 0)
+    {
+      size = sStat.st_size;
+      mtime = sStat.st_mtime;
+    }
+
+  //reuse a handle only while the file is unchanged
+  for(size_t i = 0; i < handles.size(); i++)
+    {
+      if(handles[i].path != path || handles[i].isVector != isVector)
+	continue;
+
+      cachedHandle handle = handles[i];
+      handles.erase(handles.begin() + i);
+
+      if(handle.size != size || handle.mtime != mtime || size < 0)
+	{
+	  close(handle);
+	  break;
+	}
+
+      //most recently used last
+      handles.push_back(handle);
+      return isVector ? (void *) handle.vector : (void *) handle.raster;
+    }
+
+  cachedHandle handle;
+  handle.path = path;
+  handle.isVector = isVector;
+  handle.size = size;
+  handle.mtime = mtime;
+  handle.raster = NULL;
+  handle.vector = NULL;
+
+  if(isVector)
+    handle.vector = openVectorSource(path);
+  else
+    handle.raster = (GDALDataset *) GDALOpen( path, GA_ReadOnly );
+
+  if(handle.vector == NULL && handle.raster == NULL)
+    return NULL;
+
+  if(handles.size() >= maxHandles)
+    {
+      close(handles.front());
+      handles.erase(handles.begin());
+    }
+  handles.push_back(handle);
+
+  return isVector ? (void *) handle.vector : (void *) handle.raster;
+
+}
+
+GDALDataset *geoContext::openRaster(const char *path) {
+
+  return (GDALDataset *) open(path, 0);
+
+}
+
+OGRDataSource *geoContext::openVector(const char *path) {
+
+  return (OGRDataSource *) open(path, 1);
+
+}
+
+OGRCoordinateTransformation *geoContext::getWGS84Transform(OGRSpatialReference *hSpatialRef) {
+
+  char *pszWkt = NULL;
+  std::string key;
+
+  if(hSpatialRef->exportToWkt(&pszWkt) == OGRERR_NONE)
+    key = pszWkt;
+  CPLFree(pszWkt);
+
+  std::map<std::string, OGRCoordinateTransformation *>::iterator it = wgs84.find(key);
+  if(it != wgs84.end())
+    return it->second;
+
+  OGRSpatialReference targetSpatialRef;
+  targetSpatialRef.importFromEPSG(4326);
+
+  //may be NULL, which is cached as well
+  OGRCoordinateTransformation *hTransform = OGRCreateCoordinateTransformation(hSpatialRef,&targetSpatialRef);
+  wgs84[key] = hTransform;
+
+  return hTransform;
+
+}
+
+int recordingCatalog::modify(const char *op, const std::string &objPath, const geoAVU &avu, const char *newValue) {
+
+  std::lock_guard<std::mutex> guard(lock);
+  std::set<storedAVU> &stored = metadata[objPath];
+  storedAVU row(avu.name, avu.value, avu.unit);
+
+  if(strcmp(op, "add") == 0)
+    {
+      if(!stored.insert(row).second)
+	return CATALOG_ALREADY_HAS_ITEM_BY_THAT_NAME;
+    }
+  else if(strcmp(op, "set") == 0)
+    {
+      std::set<storedAVU>::iterator it = stored.lower_bound(storedAVU(avu.name, "", ""));
+      while(it != stored.end() && std::get<0>(*it) == avu.name)
+	stored.erase(it++);
+      stored.insert(row);
+    }
+  else if(strcmp(op, "mod") == 0)
+    {
+      if(stored.erase(row) == 0)
+	return CAT_NO_ROWS_FOUND;
+      //only the v: (value) form is used by the extraction
+      if(newValue != NULL && strncmp(newValue, "v:", 2) == 0)
+	std::get<1>(row) = newValue + 2;
+      stored.insert(row);
+    }
+  else
+    return -1;
+
+  return 0;
+
+}
+
+void recordingCatalog::query(const std::string &objPath, const std::set<std::string> &names, std::vector<geoAVU> &stored) {
+
+  std::lock_guard<std::mutex> guard(lock);
+  std::map<std::string, std::set<storedAVU> >::iterator it = metadata.find(objPath);
+
+  if(it == metadata.end())
+    return;
+
+  for(std::set<storedAVU>::iterator row = it->second.begin(); row != it->second.end(); ++row)
+    if(names.empty() || names.count(std::get<0>(*row)))
+      {
+	geoAVU avu;
+	avu.name = std::get<0>(*row);
+	avu.value = std::get<1>(*row);
+	avu.unit = std::get<2>(*row);
+	stored.push_back(avu);
+      }
+
+}
+
+void recordingCatalog::restore(const std::string &objPath, const std::vector<geoAVU> &rows) {
+
+  std::lock_guard<std::mutex> guard(lock);
+  std::set<storedAVU> &stored = metadata[objPath];
+
+  stored.clear();
+  for(size_t i = 0; i < rows.size(); i++)
+    stored.insert(storedAVU(rows[i].name, rows[i].value, rows[i].unit));
+
+}
+
+void recordingCatalog::putObject(const std::string &objPath, size_t size) {
+
+  std::lock_guard<std::mutex> guard(lock);
+  objects[objPath] = size;
+
+}
+
+long recordingCatalog::load(const char *path) {
+
+  std::ifstream in(path);
+  std::string line;
+  long nAVUs = 0;
+
+  if(!in)
+    return -1;
 
-  snprintf(geoExt, sizeof geoExt, "%s", boost::filesystem::path(fileName).extension().c_str());
+  //fields are escaped, so tabs only ever separate them
+  while(std::getline(in, line))
+    {
+      size_t t1 = line.find('\t');
+      size_t t2 = t1 == std::string::npos ? t1 : line.find('\t', t1 + 1);
+      size_t t3 = t2 == std::string::npos ? t2 : line.find('\t', t2 + 1);
+      if(t3 == std::string::npos)
+	continue;
+
+      storedAVU row(geoMetadata::unescape(line.substr(t1 + 1, t2 - t1 - 1)),
+		    geoMetadata::unescape(line.substr(t2 + 1, t3 - t2 - 1)),
+		    geoMetadata::unescape(line.substr(t3 + 1)));
+
+      std::lock_guard<std::mutex> guard(lock);
+      if(metadata[geoMetadata::unescape(line.substr(0, t1))].insert(row).second)
+	nAVUs++;
+    }
+
+  return nAVUs;
+
+}
+
+std::map<std::string, std::string> geoMetadata::loadOptions() {
+
+  std::map<std::string, std::string> options;
+  const char *pszConfig = getenv("GEOMETA_CONFIG");
+  std::ifstream config(pszConfig != NULL ? pszConfig : "/etc/irods/geometa.cfg");
+  std::string line;
+
+  //one key=value per line, '#' starts a comment
+  while(std::getline(config, line))
+    {
+      size_t eq = line.find('=');
+      if(line.empty() || line[0] == '#' || eq == std::string::npos)
+	continue;
+      options[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+
+  return options;
+
+}
+
+std::string geoMetadata::getOption(const char *key) {
+
+  //read once per agent, function statics are initialized thread-safely
+  static const std::map<std::string, std::string> options = loadOptions();
+  std::map<std::string, std::string>::const_iterator it = options.find(key);
+
+  return it != options.end() ? it->second : "";
+
+}
+
+int geoMetadata::optionEnabled(const char *key) {
+
+  std::string value = getOption(key);
+
+  return !value.empty() && value != "0" && value != "false" && value != "no";
+
+}
+
+void geoMetadata::setGeoExtension() {
+
+  boost::filesystem::path logPath(objName);
+
+  snprintf(geoExt, sizeof geoExt, "%s", logPath.filename().extension().c_str());
 
   return;
 
@@ -75,38 +450,41 @@ void geoMetadata::setGeoExtension() {
 
 int geoMetadata::geospatialType() {
 
-  int vectorp, rasterp, type;
+  return extensionType(geoExt);
+  
+}
+
+int geoMetadata::extensionType(const std::string &ext) {
 
-  rasterp = std::find(std::begin(rastertypes),std::end(rastertypes),geoExt) != std::end(rastertypes);
-  vectorp = std::find(std::begin(vectortypes),std::end(vectortypes),geoExt) != std::end(vectortypes);
+  int vectorp, rasterp, archivep, type;
 
-  type = rasterp ? 1 : vectorp ? 2 : 0;
+  rasterp = std::find(std::begin(rastertypes),std::end(rastertypes),ext) != std::end(rastertypes);
+  vectorp = std::find(std::begin(vectortypes),std::end(vectortypes),ext) != std::end(vectortypes);
+
+  archivep = std::find(std::begin(archivetypes),std::end(archivetypes),ext) != std::end(archivetypes);
+
+  type = rasterp ? 1 : vectorp ? 2 : archivep ? 3 : 0;
 
   return type;
   
 }
 
+int geoMetadata::shapefilePart(const std::string &ext) {
+
+  return std::find(std::begin(shapefiletypes),std::end(shapefiletypes),ext) != std::end(shapefiletypes);
+
+}
+
 int geoMetadata::shapefileComplete()
 {
   
-  msParam_t msLogPath, msPhyPath, parentPath, childName;
   char logPath[512], phyPath[512];
   char fileName[256];
   
-  snprintf(logPath, sizeof logPath, "%s", objName);
-  snprintf(phyPath, sizeof phyPath, "%s", filePath);
-  fillStrInMsParam(&msLogPath,logPath);
-  fillStrInMsParam(&msPhyPath,phyPath);
-  
-  msiSplitPath(&msLogPath,&parentPath,&childName,rei);
-  
-  
-  snprintf(logPath, sizeof logPath, "%s", ((char *)parentPath.inOutStruct));
-  snprintf(fileName, sizeof fileName, "%s", ((char *)childName.inOutStruct));
-  
-  msiSplitPath(&msPhyPath,&parentPath,&childName,rei);
-  
-  snprintf(phyPath, sizeof phyPath, "%s", ((char *)parentPath.inOutStruct));
+  //split the logical and physical paths into parent and file name
+  snprintf(logPath, sizeof logPath, "%s", boost::filesystem::path(objName).parent_path().c_str());
+  snprintf(fileName, sizeof fileName, "%s", boost::filesystem::path(objName).filename().c_str());
+  snprintf(phyPath, sizeof phyPath, "%s", boost::filesystem::path(filePath).parent_path().c_str());
   
   char *baseName;
   
@@ -117,8 +495,6 @@ int geoMetadata::shapefileComplete()
   
   char path_dbf[512],path_shp[512],path_shx[512],path_prj[512];
   
-  FILE *dbfp, *prjp, *shpp, *shxp;
-  
   //construct paths to necessary files to check if present
   snprintf(path_prj, sizeof path_prj, "%s/%s.prj", phyPath, baseName);
   snprintf(path_dbf, sizeof path_dbf, "%s/%s.dbf", phyPath, baseName);
@@ -143,6 +519,27 @@ int geoMetadata::shapefileComplete()
 
 int geoMetadata::setMeta()
 {
+  //msiSetKeyValuePairsToObj sends one add per pair
+  if(sink != NULL || catalog != NULL)
+    catalogCalls += keyMeta.size();
+  
+  if(sink != NULL)
+    {
+      sink->insert(sink->end(), keyMeta.begin(), keyMeta.end());
+      keyMeta.clear();
+      return 0;
+    }
+  
+  //recorded as msiSetKeyValuePairsToObj writes them, one add per pair
+  if(catalog != NULL)
+    {
+      for(size_t i = 0; i < keyMeta.size(); i++)
+	catalog->modify("add", objName, keyMeta[i], NULL);
+      keyMeta.clear();
+      return 0;
+    }
+  
+#ifndef GEOMETA_STANDALONE
   msParam_t objnameparam, objtypeparam;
   int status;
   
@@ -150,20 +547,255 @@ int geoMetadata::setMeta()
   fillStrInMsParam(&objnameparam, objName);
   fillStrInMsParam(&objtypeparam, objType);
   
+  if(kvpairsparam.inOutStruct != NULL)
+    catalogCalls += ((keyValPair_t *) kvpairsparam.inOutStruct)->len;
+  
   //add all the metadata field-name pairs to the file
   status = msiSetKeyValuePairsToObj(&kvpairsparam,&objnameparam,&objtypeparam,rei);
   
   return status;
+#else
+  return -1;
+#endif
   
 }
 
 void geoMetadata::addMeta(char *key, char *value)
 {
+  //collected pairs keep the key value pair semantics,
+  //a repeated key replaces the earlier value
+  if(sink != NULL || catalog != NULL)
+    {
+      for(size_t i = 0; i < keyMeta.size(); i++)
+	if(keyMeta[i].name == key)
+	  {
+	    keyMeta[i].value = value;
+	    return;
+	  }
+      geoAVU avu;
+      avu.name = key;
+      avu.value = value;
+      avu.keyValue = 1;
+      keyMeta.push_back(avu);
+      return;
+    }
+  
+#ifndef GEOMETA_STANDALONE
   //MSParam struct objects to store metadata field name and value
   msParam_t keyparam, valparam;
   fillStrInMsParam(&keyparam,key);
   fillStrInMsParam(&valparam,value);
   msiAddKeyVal(&kvpairsparam,&keyparam,&valparam,rei);
+#endif
+}
+
+void geoMetadata::addMetaUnit(const char *key, const char *value, const char *unit)
+{
+  //queued and written by setMetaUnits, key value pairs would
+  //collapse repeated attribute names into one
+  geoAVU avu;
+  avu.name = key;
+  avu.value = value;
+  avu.unit = unit;
+  unitMeta.push_back(avu);
+}
+
+int geoMetadata::addChunkedMeta(const char *key, const std::vector<std::string> &items, int chunkLimit)
+{
+  //pack the ';' separated items into as few AVU values as possible
+  //the unit records the chunk number so the inventory can be reassembled
+  std::string chunk;
+  char unit[32];
+  int nChunks = 0;
+  int nStored = 0;
+  size_t first = unitMeta.size();
+  size_t i;
+
+  for(i = 0; i < items.size(); i++)
+    {
+      if(items[i].size() >= maxValueLength)
+	{
+	  rodsLog(LOG_NOTICE, "msiExtractGeoMeta: %s item %lu of %s exceeds %lu characters, left out",
+		  key, (unsigned long) i + 1, objName, (unsigned long) maxValueLength);
+	  continue;
+	}
+      
+      if(!chunk.empty() && chunk.size() + 1 + items[i].size() >= maxValueLength)
+	{
+	  nChunks++;
+	  snprintf(unit, sizeof unit, "chunk_%d", nChunks);
+	  addMetaUnit(key, chunk.c_str(), unit);
+	  chunk.clear();
+	  if(nChunks == chunkLimit)
+	    break;
+	}
+      
+      if(!chunk.empty())
+	chunk += ";";
+      chunk += items[i];
+      nStored++;
+    }
+  
+  if(!chunk.empty())
+    {
+      nChunks++;
+      snprintf(unit, sizeof unit, "chunk_%d", nChunks);
+      addMetaUnit(key, chunk.c_str(), unit);
+    }
+  
+  if(i < items.size())
+    rodsLog(LOG_NOTICE, "msiExtractGeoMeta: %s inventory truncated to %d chunks for %s", key, chunkLimit, objName);
+  
+  //the first chunk is written with set, dropping every chunk an
+  //earlier extraction stored, the others are added after it
+  if(unitMeta.size() > first)
+    unitMeta[first].replace = 1;
+  
+  return nStored;
+}
+
+void geoMetadata::replaceMetaUnit(const char *key, const char *value, const char *unit)
+{
+  //for single valued attributes that are extended in place on
+  //re-extraction, they must not pile up
+  addMetaUnit(key, value, unit);
+  unitMeta.back().replace = 1;
+}
+
+int geoMetadata::setMetaUnits()
+{
+  //one request per attribute, value, unit triple
+  catalogCalls += unitMeta.size();
+  
+  if(sink != NULL)
+    {
+      sink->insert(sink->end(), unitMeta.begin(), unitMeta.end());
+      unitMeta.clear();
+      return 0;
+    }
+  
+  const char *op;
+  int status = 0;
+  
+  //write all queued attribute, value, unit triples in one pass.
+  //a re-extracted object already has most of them, which is not an
+  //error, and one failed row must not cost the rows after it
+  for(size_t i = 0; i < unitMeta.size(); i++)
+    {
+      op = unitMeta[i].replace ? "set" : "add";
+      int rowStatus = modifyMeta(op, unitMeta[i], NULL);
+      if(rowStatus < 0 && rowStatus != CATALOG_ALREADY_HAS_ITEM_BY_THAT_NAME)
+	{
+	  rodsLog(LOG_ERROR, "msiExtractGeoMeta: failed to %s %s on %s, status = %d", op, unitMeta[i].name.c_str(), objName, rowStatus);
+	  if(status >= 0)
+	    status = rowStatus;
+	}
+    }
+  
+  unitMeta.clear();
+  
+  return status;
+}
+
+int geoMetadata::modifyMeta(const char *op, const geoAVU &avu, const char *newValue)
+{
+  if(catalog != NULL)
+    return catalog->modify(op, objName, avu, newValue);
+  
+#ifndef GEOMETA_STANDALONE
+  modAVUMetadataInp_t modAVUMetadataInp;
+  
+  bzero (&modAVUMetadataInp, sizeof (modAVUMetadataInp));
+  modAVUMetadataInp.arg0 = (char *) op;
+  modAVUMetadataInp.arg1 = objType;
+  modAVUMetadataInp.arg2 = objName;
+  modAVUMetadataInp.arg3 = (char *) avu.name.c_str();
+  modAVUMetadataInp.arg4 = (char *) avu.value.c_str();
+  modAVUMetadataInp.arg5 = (char *) avu.unit.c_str();
+  modAVUMetadataInp.arg6 = (char *) newValue;
+  
+  return rsModAVUMetadata(rei->rsComm, &modAVUMetadataInp);
+#else
+  return -1;
+#endif
+}
+
+int geoMetadata::readStoredMeta(const char *nameCondition, std::vector<geoAVU> &stored)
+{
+  //the recorded catalog answers with the attributes quoted in the condition
+  if(catalog != NULL)
+    {
+      std::set<std::string> names;
+      size_t open = std::string::npos;
+      
+      for(size_t i = 0; nameCondition[i] != '\0'; i++)
+	if(nameCondition[i] == '\'' && open == std::string::npos)
+	  open = i + 1;
+	else if(nameCondition[i] == '\'')
+	  {
+	    names.insert(std::string(nameCondition + open, i - open));
+	    open = std::string::npos;
+	  }
+      
+      catalogCalls++;
+      catalog->query(objName, names, stored);
+      return 0;
+    }
+  
+#ifndef GEOMETA_STANDALONE
+  char collName[MAX_NAME_LEN], dataName[MAX_NAME_LEN];
+  char condition[MAX_NAME_LEN + 8];
+  genQueryInp_t genQueryInp;
+  genQueryOut_t *genQueryOut = NULL;
+  int status;
+  
+  snprintf(collName, sizeof collName, "%s", boost::filesystem::path(objName).parent_path().c_str());
+  snprintf(dataName, sizeof dataName, "%s", boost::filesystem::path(objName).filename().c_str());
+  
+  bzero(&genQueryInp, sizeof genQueryInp);
+  genQueryInp.maxRows = MAX_SQL_ROWS;
+  addInxIval(&genQueryInp.selectInp, COL_META_DATA_ATTR_NAME, 1);
+  addInxIval(&genQueryInp.selectInp, COL_META_DATA_ATTR_VALUE, 1);
+  addInxIval(&genQueryInp.selectInp, COL_META_DATA_ATTR_UNITS, 1);
+  snprintf(condition, sizeof condition, "= '%s'", collName);
+  addInxVal(&genQueryInp.sqlCondInp, COL_COLL_NAME, condition);
+  snprintf(condition, sizeof condition, "= '%s'", dataName);
+  addInxVal(&genQueryInp.sqlCondInp, COL_DATA_NAME, condition);
+  addInxVal(&genQueryInp.sqlCondInp, COL_META_DATA_ATTR_NAME, nameCondition);
+  
+  catalogCalls++;
+  status = rsGenQuery(rei->rsComm, &genQueryInp, &genQueryOut);
+  while(status >= 0 && genQueryOut != NULL)
+    {
+      sqlResult_t *names = getSqlResultByInx(genQueryOut, COL_META_DATA_ATTR_NAME);
+      sqlResult_t *values = getSqlResultByInx(genQueryOut, COL_META_DATA_ATTR_VALUE);
+      sqlResult_t *units = getSqlResultByInx(genQueryOut, COL_META_DATA_ATTR_UNITS);
+      
+      for(int i = 0; names != NULL && values != NULL && units != NULL && i < genQueryOut->rowCnt; i++)
+	{
+	  geoAVU avu;
+	  avu.name = &names->value[names->len * i];
+	  avu.value = &values->value[values->len * i];
+	  avu.unit = &units->value[units->len * i];
+	  stored.push_back(avu);
+	}
+      
+      if(genQueryOut->continueInx <= 0)
+	break;
+      
+      genQueryInp.continueInx = genQueryOut->continueInx;
+      freeGenQueryOut(&genQueryOut);
+      catalogCalls++;
+      status = rsGenQuery(rei->rsComm, &genQueryInp, &genQueryOut);
+    }
+  
+  freeGenQueryOut(&genQueryOut);
+  clearGenQueryInp(&genQueryInp);
+  
+  return status == CAT_NO_ROWS_FOUND ? 0 : status;
+#else
+  return -1;
+#endif
 }
 
 void geoMetadata::extractVectorBasicMeta() {
@@ -192,346 +824,1453 @@ void geoMetadata::extractVectorBasicMeta() {
   
 }
 
+void geoMetadata::extractLayerInfo(OGRLayer *hLayer, vectorLayerInfo &info) {
+
+  char *pszWkt = NULL;
+  
+  info.name = hLayer->GetName();
+  info.featureCount = hLayer->GetFeatureCount();
+  
+  //attribute field names of the layer
+  OGRFeatureDefn *hFDefn = hLayer->GetLayerDefn();
+  for(int iField = 0; iField < hFDefn->GetFieldCount(); iField++ )
+    info.fields.push_back(hFDefn->GetFieldDefn( iField )->GetNameRef());
+  
+  info.hasExtent = (hLayer->GetExtent(&info.extent) == OGRERR_NONE);
+  
+  OGRSpatialReference *hSpatialRef = hLayer->GetSpatialRef();
+  
+  if(hSpatialRef != NULL)
+    {
+      const char *pszProjection = hSpatialRef->GetAttrValue("PROJECTION",0);
+      info.projection = pszProjection != NULL ? pszProjection : "";
+      
+      if(hSpatialRef->exportToWkt(&pszWkt) == OGRERR_NONE)
+	info.srsWkt = pszWkt;
+      CPLFree(pszWkt);
+    }
+  
+  //re-project all four corners of the extent in one call
+  if(info.hasExtent && hSpatialRef != NULL)
+    {
+      OGRCoordinateTransformation *poCT = geoContext::current().getWGS84Transform(hSpatialRef);
+      
+      if(NULL != poCT)
+	{
+	  double x[4] = {info.extent.MinX, info.extent.MinX, info.extent.MaxX, info.extent.MaxX};
+	  double y[4] = {info.extent.MinY, info.extent.MaxY, info.extent.MinY, info.extent.MaxY};
+	  
+	  if(poCT->Transform(4,x,y))
+	    {
+	      info.transformed = 1;
+	      info.extentLatLon.MinX = *std::min_element(x,x+4);
+	      info.extentLatLon.MaxX = *std::max_element(x,x+4);
+	      info.extentLatLon.MinY = *std::min_element(y,y+4);
+	      info.extentLatLon.MaxY = *std::max_element(y,y+4);
+	    }
+	}
+    }
+  
+  info.done = 1;
+  
+}
+
+void geoMetadata::extractVectorLayers() {
+
+  int nLayers = poDS->GetLayerCount();
+  
+  layers.assign(nLayers, vectorLayerInfo());
+  
+  //OGR datasources are not thread-safe so every worker
+  //uses the handle of its own context
+  if(workerCount(nLayers) > 1)
+    {
+      runWorkers(nLayers, [this](int iLayer, int) {
+	  OGRDataSource *hDS = geoContext::current().openVector(filePath);
+	  OGRLayer *hLayer = hDS != NULL ? hDS->GetLayer(iLayer) : NULL;
+	  if(hLayer != NULL)
+	    extractLayerInfo(hLayer, layers[iLayer]);
+	});
+    }
+  
+  //anything a worker could not handle is done on the main handle
+  for(int iLayer = 0; iLayer < nLayers; iLayer++)
+    {
+      OGRLayer *hLayer;
+      if(!layers[iLayer].done && (hLayer = poDS->GetLayer(iLayer)) != NULL)
+	extractLayerInfo(hLayer, layers[iLayer]);
+    }
+  
+}
+
+hullBuilder::hullBuilder() : gridSize(0) {
+
+}
+
+hullBuilder::hullBuilder(const OGREnvelope &gridExtent, int size) :
+  grid((size_t)size * size, 0), gridSize(size), extent(gridExtent) {
+
+}
+
+void hullBuilder::mark(double x, double y) {
+
+  double width = extent.MaxX - extent.MinX;
+  double height = extent.MaxY - extent.MinY;
+  int col = width > 0 ? (int)((x - extent.MinX) / width * gridSize) : 0;
+  int row = height > 0 ? (int)((extent.MaxY - y) / height * gridSize) : 0;
+
+  col = std::min(std::max(col, 0), gridSize - 1);
+  row = std::min(std::max(row, 0), gridSize - 1);
+
+  grid[(size_t)row * gridSize + col] = 1;
+
+}
+
+void hullBuilder::addPoint(double x, double y) {
+
+  if(gridSize > 0)
+    {
+      mark(x, y);
+      return;
+    }
+
+  xs.push_back(x);
+  ys.push_back(y);
+
+  if(xs.size() >= maxPoints)
+    reduce();
+
+}
+
+void hullBuilder::addSegment(double x1, double y1, double x2, double y2) {
+
+  //the hull of a segment is the hull of its end points
+  if(gridSize == 0)
+    {
+      addPoint(x2, y2);
+      return;
+    }
+
+  //walk the segment in steps no longer than a grid cell
+  double cellWidth = (extent.MaxX - extent.MinX) / gridSize;
+  double cellHeight = (extent.MaxY - extent.MinY) / gridSize;
+  double dx = cellWidth > 0 ? std::fabs(x2 - x1) / cellWidth : 0.0;
+  double dy = cellHeight > 0 ? std::fabs(y2 - y1) / cellHeight : 0.0;
+  int steps = (int)std::min(std::max(dx, dy), 2.0 * gridSize) + 1;
+
+  for(int i = 0; i <= steps; i++)
+    mark(x1 + (x2 - x1) * i / steps, y1 + (y2 - y1) * i / steps);
+
+}
+
+void hullBuilder::addGeometry(OGRGeometry *hGeometry) {
+
+  switch(wkbFlatten(hGeometry->getGeometryType()))
+    {
+    case wkbPoint:
+      addPoint(((OGRPoint *) hGeometry)->getX(), ((OGRPoint *) hGeometry)->getY());
+      break;
+    case wkbLineString:
+    case wkbLinearRing:
+      {
+	OGRLineString *hLine = (OGRLineString *) hGeometry;
+	for(int i = 0; i < hLine->getNumPoints(); i++)
+	  {
+	    if(i == 0)
+	      addPoint(hLine->getX(i), hLine->getY(i));
+	    else
+	      addSegment(hLine->getX(i-1), hLine->getY(i-1), hLine->getX(i), hLine->getY(i));
+	  }
+	break;
+      }
+    case wkbPolygon:
+      {
+	//interior rings lie inside the exterior ring
+	OGRPolygon *hPolygon = (OGRPolygon *) hGeometry;
+	if(hPolygon->getExteriorRing() != NULL)
+	  addGeometry(hPolygon->getExteriorRing());
+	break;
+      }
+    case wkbMultiPoint:
+    case wkbMultiLineString:
+    case wkbMultiPolygon:
+    case wkbGeometryCollection:
+      {
+	OGRGeometryCollection *hCollection = (OGRGeometryCollection *) hGeometry;
+	for(int i = 0; i < hCollection->getNumGeometries(); i++)
+	  addGeometry(hCollection->getGeometryRef(i));
+	break;
+      }
+    default:
+      break;
+    }
+
+}
+
+void hullBuilder::reduce() {
+
+  size_t n = xs.size();
+  if(n < 3)
+    return;
+
+  //andrew's monotone chain
+  std::vector<size_t> order(n), hull(2 * n);
+  for(size_t i = 0; i < n; i++)
+    order[i] = i;
+
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+      return xs[a] < xs[b] || (xs[a] == xs[b] && ys[a] < ys[b]);
+    });
+
+  auto cross = [this](size_t o, size_t a, size_t b) {
+    return (xs[a] - xs[o]) * (ys[b] - ys[o]) - (ys[a] - ys[o]) * (xs[b] - xs[o]);
+  };
+
+  size_t k = 0;
+  for(size_t i = 0; i < n; i++)
+    {
+      while(k >= 2 && cross(hull[k-2], hull[k-1], order[i]) <= 0)
+	k--;
+      hull[k++] = order[i];
+    }
+  for(size_t i = n - 1, t = k + 1; i > 0; i--)
+    {
+      while(k >= t && cross(hull[k-2], hull[k-1], order[i-1]) <= 0)
+	k--;
+      hull[k++] = order[i-1];
+    }
+
+  //the last point repeats the first
+  std::vector<double> hx(k - 1), hy(k - 1);
+  for(size_t i = 0; i + 1 < k; i++)
+    {
+      hx[i] = xs[hull[i]];
+      hy[i] = ys[hull[i]];
+    }
+
+  xs.swap(hx);
+  ys.swap(hy);
+
+}
+
+void hullBuilder::merge(const hullBuilder &other) {
+
+  if(gridSize > 0)
+    {
+      for(size_t i = 0; i < grid.size() && i < other.grid.size(); i++)
+	grid[i] |= other.grid[i];
+      return;
+    }
+
+  xs.insert(xs.end(), other.xs.begin(), other.xs.end());
+  ys.insert(ys.end(), other.ys.begin(), other.ys.end());
+  reduce();
+
+}
+
+OGRGeometry *hullBuilder::convexHull() {
+
+  reduce();
+
+  if(xs.size() < 3)
+    return NULL;
+
+  OGRLinearRing *hRing = new OGRLinearRing();
+  for(size_t i = 0; i < xs.size(); i++)
+    hRing->addPoint(xs[i], ys[i]);
+  hRing->addPoint(xs[0], ys[0]);
+
+  OGRPolygon *hPolygon = new OGRPolygon();
+  hPolygon->addRingDirectly(hRing);
+
+  return hPolygon;
+
+}
+
+int hullBuilder::gridMask(std::vector<GByte> &mask, double *adfTransform) {
+
+  if(gridSize == 0)
+    return 0;
+
+  //grow occupied cells by one so neighbouring vertices connect,
+  //the cell size acts as the alpha of the shape
+  mask.assign(grid.size(), 0);
+  for(int row = 0; row < gridSize; row++)
+    for(int col = 0; col < gridSize; col++)
+      {
+	if(!grid[(size_t)row * gridSize + col])
+	  continue;
+	for(int r = std::max(row - 1, 0); r <= std::min(row + 1, gridSize - 1); r++)
+	  for(int c = std::max(col - 1, 0); c <= std::min(col + 1, gridSize - 1); c++)
+	    mask[(size_t)r * gridSize + c] = 1;
+      }
+
+  adfTransform[0] = extent.MinX;
+  adfTransform[1] = (extent.MaxX - extent.MinX) / gridSize;
+  adfTransform[2] = 0.0;
+  adfTransform[3] = extent.MaxY;
+  adfTransform[4] = 0.0;
+  adfTransform[5] = -(extent.MaxY - extent.MinY) / gridSize;
+
+  return 1;
+
+}
+
+void geoMetadata::extractVectorFootprint() {
+
+  int concave = (getOption("footprint") == "concave");
+  OGREnvelope extent;
+  int hasExtent = 0;
+  
+  //only layers in the projection of the reference layer share coordinates
+  struct workItem { int layer; long long start; long long count; };
+  std::vector<workItem> items;
+  int reference = referenceLayer();
+  
+  if(reference < 0)
+    return;
+  
+  for(size_t i = 0; i < layers.size(); i++)
+    {
+      if(!layers[i].hasExtent || layers[i].srsWkt != layers[reference].srsWkt || layers[i].featureCount <= 0)
+	continue;
+      
+      extent.Merge(layers[i].extent);
+      hasExtent = 1;
+      
+      //split layers that support random access into chunks of features
+      OGRLayer *hLayer = poDS->GetLayer(i);
+      if(hLayer->TestCapability(OLCFastSetNextByIndex))
+	{
+	  for(long long start = 0; start < layers[i].featureCount; start += footprintChunkFeatures)
+	    {
+	      workItem item = {(int)i, start, std::min(footprintChunkFeatures, layers[i].featureCount - start)};
+	      items.push_back(item);
+	    }
+	}
+      else
+	{
+	  workItem item = {(int)i, 0, -1};
+	  items.push_back(item);
+	}
+    }
+  
+  if(!hasExtent)
+    return;
+  
+  int nThreads = workerCount(items.size());
+  std::vector<hullBuilder> builders(nThreads, concave ? hullBuilder(extent, footprintGridSize) : hullBuilder());
+  std::atomic<int> failed(0);
+  
+  //one hull builder per worker, merged once all items are done
+  runWorkers(items.size(), [this, &items, &builders, &failed](int iItem, int t) {
+      OGRDataSource *hDS = geoContext::current().openVector(filePath);
+      if(hDS == NULL)
+	{
+	  failed = 1;
+	  return;
+	}
+      
+      OGRLayer *hLayer = hDS->GetLayer(items[iItem].layer);
+      OGRFeatureDefn *hFDefn = hLayer->GetLayerDefn();
+      OGRFeature *hFeature;
+      
+      //attributes are not needed for the geometry pass
+      std::vector<const char *> ignored;
+      for(int iField = 0; iField < hFDefn->GetFieldCount(); iField++)
+	ignored.push_back(hFDefn->GetFieldDefn(iField)->GetNameRef());
+      ignored.push_back("OGR_STYLE");
+      ignored.push_back(NULL);
+      hLayer->SetIgnoredFields(&ignored[0]);
+      
+      hLayer->ResetReading();
+      if(items[iItem].start > 0)
+	hLayer->SetNextByIndex(items[iItem].start);
+      
+      for(long long n = 0; items[iItem].count < 0 || n < items[iItem].count; n++)
+	{
+	  if((hFeature = hLayer->GetNextFeature()) == NULL)
+	    break;
+	  if(hFeature->GetGeometryRef() != NULL)
+	    builders[t].addGeometry(hFeature->GetGeometryRef());
+	  OGRFeature::DestroyFeature(hFeature);
+	}
+      
+      //the cached handle is shared with later stages
+      hLayer->SetIgnoredFields(NULL);
+    });
+  
+  if(failed || builders.empty())
+    {
+      rodsLog(LOG_NOTICE, "msiExtractGeoMeta: could not compute vector footprint for %s", objName);
+      return;
+    }
+  
+  for(size_t t = 1; t < builders.size(); t++)
+    builders[0].merge(builders[t]);
+  
+  OGRGeometry *footprint = NULL;
+  if(concave)
+    {
+      std::vector<GByte> mask;
+      double adfTransform[6];
+      if(builders[0].gridMask(mask, adfTransform))
+	footprint = polygonizeMask(mask, footprintGridSize, footprintGridSize, adfTransform, 1);
+    }
+  else
+    footprint = builders[0].convexHull();
+  
+  if(footprint == NULL)
+    return;
+  
+  //stored in EPSG:4326 alongside latmin/lonmax
+  const std::string &srsWkt = layers[reference].srsWkt;
+  OGRSpatialReference sourceSpatialRef(srsWkt.empty() ? NULL : srsWkt.c_str());
+  OGRCoordinateTransformation *hTransform = NULL;
+  
+  if(!srsWkt.empty())
+    hTransform = geoContext::current().getWGS84Transform(&sourceSpatialRef);
+  
+  addFootprintMeta(footprint, hTransform);
+  
+  delete footprint;
+  
+}
+
+int geoMetadata::referenceLayer() const {
+
+  //tables without geometry are listed as layers too, with no extent
+  for(size_t i = 0; i < layers.size(); i++)
+    if(layers[i].hasExtent)
+      return i;
+
+  return -1;
+
+}
+
 void geoMetadata::extractVectorBounds() {
 
   char metaname[128];
   char metavalue[128];
   
-  OGRSpatialReference *hSpatialRef;
-  OGREnvelope *hExtent = new OGREnvelope();
-  OGRCoordinateTransformation *poCT;
+  extractVectorLayers();
+  
+  if(layers.empty())
+    return;
+  
+  //natural extents are only comparable between layers sharing the
+  //spatial reference of the reference layer, lat-lon extents always are
+  OGREnvelope hExtent, hExtentLatLon;
+  int hasExtent = 0, transformed = 0;
+  int reference = referenceLayer();
+  
+  for(size_t i = 0; i < layers.size(); i++)
+    {
+      if(!layers[i].hasExtent)
+	continue;
+      
+      if(layers[i].srsWkt == layers[reference].srsWkt)
+	{
+	  hExtent.Merge(layers[i].extent);
+	  hasExtent = 1;
+	}
+      
+      if(layers[i].transformed)
+	{
+	  hExtentLatLon.Merge(layers[i].extentLatLon);
+	  transformed = 1;
+	}
+    }
+  
+  snprintf(metaname, sizeof metaname, "projection");
+  snprintf(metavalue, sizeof metavalue, "%s", layers[reference < 0 ? 0 : reference].projection.c_str());
+  addMeta(metaname,metavalue);
+  
+  if(!hasExtent)
+    return;
+  
+  double x1,y1,x2,y2;
+  
+  x1 = hExtent.MinX;
+  y1 = hExtent.MinY;
+  x2 = hExtent.MaxX;
+  y2 = hExtent.MaxY;
+  
+  //extract natural and re-projected extents
+  snprintf(metaname, sizeof metaname, "northlimit");
+  snprintf(metavalue, sizeof metavalue, "%f", y2);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "eastlimit");
+  snprintf(metavalue, sizeof metavalue, "%f", x2);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "westlimit");
+  snprintf(metavalue, sizeof metavalue, "%f", x1);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "southlimit");
+  snprintf(metavalue, sizeof metavalue, "%f", y1);
+  addMeta(metaname, metavalue);
+  
+  if(transformed)
+    {
+      x1 = hExtentLatLon.MinX;
+      y1 = hExtentLatLon.MinY;
+      x2 = hExtentLatLon.MaxX;
+      y2 = hExtentLatLon.MaxY;
+    }
+  
+  snprintf(metaname, sizeof metaname, "latmax");
+  snprintf(metavalue, sizeof metavalue, "%f", y2);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "lonmax");
+  snprintf(metavalue, sizeof metavalue, "%f", x2);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "lonmin");
+  snprintf(metavalue, sizeof metavalue, "%f", x1);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "latmin");
+  snprintf(metavalue, sizeof metavalue, "%f", y1);
+  addMeta(metaname, metavalue);
+  
+  return;
+  
+}
+
+void geoMetadata::extractMetaShp()
+{
+  //if the dataset object is NULL just return
+  //constructor initializes it and may fail to do so
+  //if the shapefile dataset is incompletely uploaded
+  //requires a shx, shp, prj and dbf file atleast
+  if( poDS == NULL )
+    {
+      rodsLog(LOG_ERROR, "Error occurred during shapefile metadata extraction: null dataset. Make sure atleast the .prj, .shp, .shx and .dbf files are present.");
+      rei->status = -1;
+      return;
+    }
+  
+  extractVectorBasicMeta();
+  
+  if(optionEnabled("footprint"))
+    extractVectorFootprint();
+  
+  char subject[2700];
+  char metaname[128];
+  char metavalue[128];
+  std::vector<std::string> fieldNames;
+  std::vector<std::string> layerItems;
+  
+  subject[0] = '\0';
+  
+  //each feature has attribute fields
+  //extract the names of these attributes from every layer
+  //to be used as metadata for search
+  for(size_t i = 0; i < layers.size(); i++)
+    for(size_t j = 0; j < layers[i].fields.size(); j++)
+      if(std::find(fieldNames.begin(), fieldNames.end(), layers[i].fields[j]) == fieldNames.end())
+	fieldNames.push_back(layers[i].fields[j]);
+  
+  for(size_t i = 0; i < fieldNames.size(); i++)
+    {
+      //stop before overrunning the AVU value length
+      if(strlen(subject) + fieldNames[i].size() + 2 > sizeof subject)
+	break;
+      if(i > 0)
+	strcat(subject,",");
+      strcat(subject,fieldNames[i].c_str());
+    }
+  
+  snprintf(metaname, sizeof metaname, "subject");
+  addMeta(metaname, subject);
+  
+  //multi-layer sources get a per-layer inventory packed into a
+  //bounded number of chunks: name|features|projection|w,s,e,n|fields
+  if(layers.size() > 1)
+    {
+      snprintf(metaname, sizeof metaname, "layercount");
+      snprintf(metavalue, sizeof metavalue, "%d", (int)layers.size());
+      addMeta(metaname, metavalue);
+      
+      for(size_t i = 0; i < layers.size(); i++)
+	{
+	  char bounds[128];
+	  const OGREnvelope &env = layers[i].transformed ? layers[i].extentLatLon : layers[i].extent;
+	  
+	  if(layers[i].hasExtent)
+	    snprintf(bounds, sizeof bounds, "%f,%f,%f,%f", env.MinX, env.MinY, env.MaxX, env.MaxY);
+	  else
+	    bounds[0] = '\0';
+	  
+	  std::string fields;
+	  for(size_t j = 0; j < layers[i].fields.size(); j++)
+	    fields += (j > 0 ? "," : "") + inventoryField(layers[i].fields[j]);
+	  
+	  //names may contain any of the separators, so they are escaped
+	  snprintf(metavalue, sizeof metavalue, "%lld", layers[i].featureCount);
+	  layerItems.push_back(inventoryField(layers[i].name) + "|" + metavalue + "|" +
+			       inventoryField(layers[i].projection) + "|" + bounds + "|" + fields);
+	}
+      
+      snprintf(metaname, sizeof metaname, "layer");
+      addChunkedMeta(metaname, layerItems, maxChunks);
+    }
+  
+  rei->status = setMeta();
+  
+  if(rei->status >= 0)
+    rei->status = setMetaUnits();
+  
+  return;
+}
+
+void geoMetadata::extractRasterBasicMeta() {
+
+  char metaname[128];
+  char metavalue[128];
+  
+  GDALDriver *hDriver = poDataset->GetDriver();
+  
+  //extract raster format 
+  snprintf(metaname, sizeof metaname, "format");
+  snprintf(metavalue, sizeof metavalue, "%s", hDriver->GetMetadataItem(GDAL_DMD_EXTENSION));
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "type");
+  snprintf(metavalue, sizeof metavalue, "geospatial");
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "language");
+  snprintf(metavalue, sizeof metavalue, "%s", hDriver->GetMetadataItem(GDAL_DMD_EXTENSION));
+  addMeta(metaname, metavalue);
+  
+  extractRasterBounds();
+  
+  return;
+  
+}
+
+transformCache::~transformCache() {
+
+  std::map<std::string, OGRCoordinateTransformation *>::iterator it;
+  for(it = transforms.begin(); it != transforms.end(); ++it)
+    if(it->second != NULL)
+      OGRCoordinateTransformation::DestroyCT(it->second);
+
+  std::map<std::string, OGRSpatialReference *>::iterator sit;
+  for(sit = sourceRefs.begin(); sit != sourceRefs.end(); ++sit)
+    delete sit->second;
+
+}
+
+OGRCoordinateTransformation *transformCache::getTransform(const char *pszWkt, OGRSpatialReference **hSpatialRef) {
+
+  std::string key(pszWkt);
+  std::map<std::string, OGRCoordinateTransformation *>::iterator it = transforms.find(key);
+
+  if(it != transforms.end())
+    {
+      *hSpatialRef = sourceRefs[key];
+      return it->second;
+    }
+
+  //first time this projection is seen, parse it once and keep both
+  //the spatial reference and its transform (which may be NULL)
+  OGRSpatialReference *sourceRef = new OGRSpatialReference( pszWkt );
+  OGRSpatialReference *targetRef = sourceRef->CloneGeogCS();
+  OGRCoordinateTransformation *hTransform = NULL;
+
+  if(targetRef != NULL)
+    {
+      hTransform = OGRCreateCoordinateTransformation(sourceRef,targetRef);
+      delete targetRef;
+    }
+
+  sourceRefs[key] = sourceRef;
+  transforms[key] = hTransform;
+
+  *hSpatialRef = sourceRef;
+  return hTransform;
+
+}
+
+void geoMetadata::computeRasterBounds(GDALDataset *hDataset, transformCache &cache, rasterBounds &bounds) {
+
+  double adfGeoTransform[6];
+  const char *pszProjection = hDataset->GetProjectionRef();
+
+  bounds.xsize = hDataset->GetRasterXSize();
+  bounds.ysize = hDataset->GetRasterYSize();
+  bounds.bands = hDataset->GetRasterCount();
+
+  if( pszProjection == NULL || hDataset->GetGeoTransform( adfGeoTransform ) != CE_None )
+    return;
+
+  //is georeferenced
+  bounds.georeferenced = 1;
+
+  OGRSpatialReference *hSpatialRef = NULL;
+  OGRCoordinateTransformation *hTransform = cache.getTransform(pszProjection, &hSpatialRef);
+
+  const char *pszName = hSpatialRef->GetAttrValue("PROJECTION",0);
+  bounds.projection = pszName != NULL ? pszName : "";
+
+  //corners of the raster, in pixel/line order
+  //(0,0), (0,ysize), (xsize,0), (xsize,ysize)
+  double x[4], y[4];
+  for(int i = 0; i < 4; i++)
+    {
+      double pixel = (i & 2) ? bounds.xsize : 0.0;
+      double line = (i & 1) ? bounds.ysize : 0.0;
+      x[i] = adfGeoTransform[0] + adfGeoTransform[1] * pixel + adfGeoTransform[2] * line;
+      y[i] = adfGeoTransform[3] + adfGeoTransform[4] * pixel + adfGeoTransform[5] * line;
+    }
+
+  bounds.westlimit = *std::min_element(x,x+4);
+  bounds.eastlimit = *std::max_element(x,x+4);
+  bounds.southlimit = *std::min_element(y,y+4);
+  bounds.northlimit = *std::max_element(y,y+4);
+
+  //re-project the corners in one call
+  if(NULL != hTransform && hTransform->Transform(4,x,y))
+    {
+      bounds.transformed = 1;
+      bounds.lonmin = *std::min_element(x,x+4);
+      bounds.lonmax = *std::max_element(x,x+4);
+      bounds.latmin = *std::min_element(y,y+4);
+      bounds.latmax = *std::max_element(y,y+4);
+    }
+  else
+    {
+      bounds.lonmin = bounds.westlimit;
+      bounds.lonmax = bounds.eastlimit;
+      bounds.latmin = bounds.southlimit;
+      bounds.latmax = bounds.northlimit;
+    }
+
+}
+
+void geoMetadata::extractRasterBounds() {
+
+  char metaname[128];
+  char metavalue[128];
+  transformCache &cache = geoContext::current().transforms();
+  rasterBounds bounds;
+  
+  computeRasterBounds(poDataset, cache, bounds);
+  
+  snprintf(metaname, sizeof metaname, "xsize");
+  snprintf(metavalue, sizeof metavalue, "%d",bounds.xsize);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "ysize");
+  snprintf(metavalue, sizeof metavalue, "%d",bounds.ysize);
+  addMeta(metaname, metavalue);
+  
+  //set coverage information
+  //includes north,east,west and southlimit and projection if any
+  //will also store bounds in lat-lon to make it easier to search
+  if( !bounds.georeferenced )
+    return;
+  
+  //projection attribute for coverage
+  snprintf(metaname, sizeof metaname, "projection");
+  snprintf(metavalue, sizeof metavalue, "%s", bounds.projection.c_str());
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "northlimit");
+  snprintf(metavalue, sizeof metavalue, "%f", bounds.northlimit);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "eastlimit");
+  snprintf(metavalue, sizeof metavalue, "%f", bounds.eastlimit);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "westlimit");
+  snprintf(metavalue, sizeof metavalue, "%f", bounds.westlimit);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "southlimit");
+  snprintf(metavalue, sizeof metavalue, "%f", bounds.southlimit);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "latmax");
+  snprintf(metavalue, sizeof metavalue, "%f", bounds.latmax);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "lonmax");
+  snprintf(metavalue, sizeof metavalue, "%f", bounds.lonmax);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "lonmin");
+  snprintf(metavalue, sizeof metavalue, "%f", bounds.lonmin);
+  addMeta(metaname, metavalue);
+  
+  snprintf(metaname, sizeof metaname, "latmin");
+  snprintf(metavalue, sizeof metavalue, "%f", bounds.latmin);
+  addMeta(metaname, metavalue);
+  
+  if(optionEnabled("footprint"))
+    extractRasterFootprint(cache);
+  
+}
+
+void geoMetadata::buildValidMask(const float *pixels, GByte *mask, size_t count, float nodata) {
+
+  size_t i = 0;
+  
+#ifdef __SSE2__
+  //four pixels per comparison, a pixel is valid when it differs
+  //from nodata and is not NaN (a NaN nodata value leaves only
+  //the NaN test)
+  const __m128 vnodata = _mm_set1_ps(nodata);
+  
+  for(; i + 4 <= count; i += 4)
+    {
+      __m128 v = _mm_loadu_ps(pixels + i);
+      __m128 valid = _mm_and_ps(_mm_cmpneq_ps(v, vnodata), _mm_cmpord_ps(v, v));
+      int bits = _mm_movemask_ps(valid);
+      
+      mask[i] = bits & 1;
+      mask[i+1] = (bits >> 1) & 1;
+      mask[i+2] = (bits >> 2) & 1;
+      mask[i+3] = (bits >> 3) & 1;
+    }
+#endif
+  
+  for(; i < count; i++)
+    mask[i] = (pixels[i] != nodata) && (pixels[i] == pixels[i]);
+  
+}
+
+void geoMetadata::extractRasterFootprint(transformCache &cache) {
+
+  double adfGeoTransform[6];
+  const char *pszProjection = poDataset->GetProjectionRef();
+  GDALRasterBand *hBand = poDataset->GetRasterBand(1);
+  
+  if(hBand == NULL || pszProjection == NULL || poDataset->GetGeoTransform( adfGeoTransform ) != CE_None)
+    return;
+  
+  int hasNoData = 0;
+  double nodata = hBand->GetNoDataValue(&hasNoData);
+  
+  //without nodata or a mask every pixel is valid and the
+  //footprint is the bounding box already stored
+  if(!hasNoData && (hBand->GetMaskFlags() & GMF_ALL_VALID))
+    return;
+  
+  //coarsest overview that still has enough pixels to cover the budget,
+  //falls back to the full resolution band read with decimation
+  GDALRasterBand *hSource = hBand;
+  for(int i = 0; i < hBand->GetOverviewCount(); i++)
+    {
+      GDALRasterBand *hOverview = hBand->GetOverview(i);
+      if(hOverview != NULL &&
+	 (double)hOverview->GetXSize() * hOverview->GetYSize() >= footprintMaxPixels &&
+	 hOverview->GetXSize() < hSource->GetXSize())
+	hSource = hOverview;
+    }
+  
+  int srcXSize = hSource->GetXSize();
+  int srcYSize = hSource->GetYSize();
+  double scale = std::sqrt((double)footprintMaxPixels / ((double)srcXSize * srcYSize));
+  if(scale > 1.0)
+    scale = 1.0;
+  
+  int bufXSize = std::max(1, (int)(srcXSize * scale));
+  int bufYSize = std::max(1, (int)(srcYSize * scale));
+  std::vector<GByte> mask((size_t)bufXSize * bufYSize);
+  
+  CPLErr err;
+  if(hasNoData)
+    {
+      std::vector<float> pixels(mask.size());
+      err = hSource->RasterIO(GF_Read, 0, 0, srcXSize, srcYSize, &pixels[0], bufXSize, bufYSize, GDT_Float32, 0, 0);
+      if(err == CE_None)
+	buildValidMask(&pixels[0], &mask[0], mask.size(), (float)nodata);
+    }
+  else
+    {
+      //mask bands are 0 for invalid and non-zero for valid pixels
+      err = hSource->GetMaskBand()->RasterIO(GF_Read, 0, 0, srcXSize, srcYSize, &mask[0], bufXSize, bufYSize, GDT_Byte, 0, 0);
+      for(size_t i = 0; i < mask.size(); i++)
+	mask[i] = mask[i] != 0;
+    }
+  
+  if(err != CE_None)
+    return;
+  
+  double xScale = (double)poDataset->GetRasterXSize() / bufXSize;
+  double yScale = (double)poDataset->GetRasterYSize() / bufYSize;
+  double adfMaskTransform[6] = {adfGeoTransform[0], adfGeoTransform[1] * xScale, adfGeoTransform[2] * yScale,
+				adfGeoTransform[3], adfGeoTransform[4] * xScale, adfGeoTransform[5] * yScale};
+  
+  OGRGeometry *footprint = polygonizeMask(mask, bufXSize, bufYSize, adfMaskTransform, 0);
+  
+  if(footprint != NULL)
+    {
+      OGRSpatialReference *hSpatialRef = NULL;
+      OGRCoordinateTransformation *hTransform = cache.getTransform(pszProjection, &hSpatialRef);
+      
+      addFootprintMeta(footprint, hTransform);
+      delete footprint;
+    }
+  
+}
+
+OGRGeometry *geoMetadata::polygonizeMask(std::vector<GByte> &mask, int xSize, int ySize, double *adfTransform, int exteriorOnly) {
+
+  //in-memory copy of the mask carrying the geotransform of the buffer
+  GDALDriver *hMemDriver = GetGDALDriverManager()->GetDriverByName("MEM");
+  OGRSFDriver *hOGRMemDriver = OGRSFDriverRegistrar::GetRegistrar()->GetDriverByName("Memory");
+  if(hMemDriver == NULL || hOGRMemDriver == NULL)
+    return NULL;
+  
+  GDALDataset *hMask = hMemDriver->Create("", xSize, ySize, 1, GDT_Byte, NULL);
+  if(hMask == NULL)
+    return NULL;
+  hMask->SetGeoTransform(adfTransform);
+  hMask->GetRasterBand(1)->RasterIO(GF_Write, 0, 0, xSize, ySize, &mask[0], xSize, ySize, GDT_Byte, 0, 0);
+  
+  OGRDataSource *hPolygons = hOGRMemDriver->CreateDataSource("footprint");
+  OGRLayer *hLayer = hPolygons != NULL ? hPolygons->CreateLayer("footprint", NULL, wkbPolygon) : NULL;
+  OGRMultiPolygon *footprint = NULL;
+  
+  //using the mask as its own mask band skips the invalid (0) areas
+  if(hLayer != NULL &&
+     GDALPolygonize((GDALRasterBandH) hMask->GetRasterBand(1), (GDALRasterBandH) hMask->GetRasterBand(1),
+		    (OGRLayerH) hLayer, -1, NULL, NULL, NULL) == CE_None)
+    {
+      std::vector<OGRPolygon *> polygons;
+      OGRFeature *hFeature;
+      double maxArea = 0.0;
+      
+      hLayer->ResetReading();
+      while((hFeature = hLayer->GetNextFeature()) != NULL)
+	{
+	  OGRGeometry *hGeometry = hFeature->GetGeometryRef();
+	  if(hGeometry != NULL && wkbFlatten(hGeometry->getGeometryType()) == wkbPolygon)
+	    {
+	      OGRPolygon *hPolygon = (OGRPolygon *) hGeometry;
+	      
+	      //filling holes keeps only the outline
+	      if(exteriorOnly && hPolygon->getExteriorRing() != NULL)
+		{
+		  OGRPolygon *hFilled = new OGRPolygon();
+		  hFilled->addRing(hPolygon->getExteriorRing());
+		  polygons.push_back(hFilled);
+		}
+	      else
+		polygons.push_back((OGRPolygon *) hPolygon->clone());
+	      
+	      maxArea = std::max(maxArea, polygons.back()->get_Area());
+	    }
+	  OGRFeature::DestroyFeature(hFeature);
+	}
+      
+      //valid areas of 4-connected pixels never overlap, so the footprint is
+      //the collection of the significant ones, speckle is dropped
+      footprint = new OGRMultiPolygon();
+      for(size_t i = 0; i < polygons.size(); i++)
+	{
+	  if(polygons[i]->get_Area() >= maxArea * 0.01)
+	    footprint->addGeometryDirectly(polygons[i]);
+	  else
+	    delete polygons[i];
+	}
+      
+      if(footprint->getNumGeometries() == 0)
+	{
+	  delete footprint;
+	  footprint = NULL;
+	}
+    }
+  
+  if(hPolygons != NULL)
+    OGRDataSource::DestroyDataSource(hPolygons);
+  GDALClose((GDALDatasetH) hMask);
+  
+  return footprint;
+  
+}
+
+static void collectRings(OGRGeometry *hGeometry, std::vector<OGRLinearRing *> &rings, int exteriorOnly) {
+
+  switch(wkbFlatten(hGeometry->getGeometryType()))
+    {
+    case wkbPolygon:
+      {
+	OGRPolygon *hPolygon = (OGRPolygon *) hGeometry;
+	if(hPolygon->getExteriorRing() != NULL)
+	  rings.push_back(hPolygon->getExteriorRing());
+	for(int i = 0; !exteriorOnly && i < hPolygon->getNumInteriorRings(); i++)
+	  rings.push_back(hPolygon->getInteriorRing(i));
+	break;
+      }
+    case wkbMultiPolygon:
+    case wkbGeometryCollection:
+      {
+	OGRGeometryCollection *hCollection = (OGRGeometryCollection *) hGeometry;
+	for(int i = 0; i < hCollection->getNumGeometries(); i++)
+	  collectRings(hCollection->getGeometryRef(i), rings, exteriorOnly);
+	break;
+      }
+    default:
+      break;
+    }
+
+}
+
+static int countVertices(OGRGeometry *hGeometry) {
+
+  std::vector<OGRLinearRing *> rings;
+  int nVertices = 0;
+
+  collectRings(hGeometry, rings, 0);
+  for(size_t i = 0; i < rings.size(); i++)
+    nVertices += rings[i]->getNumPoints();
+
+  return nVertices;
+
+}
+
+static void encodePolylineValue(double value, double &previous, std::string &encoded) {
+
+  //google encoded polyline, 5 decimal places per coordinate delta
+  int delta = (int)std::floor(value * 1e5 + 0.5) - (int)std::floor(previous * 1e5 + 0.5);
+  unsigned int bits = delta < 0 ? ~((unsigned int)delta << 1) : ((unsigned int)delta << 1);
+
+  while(bits >= 0x20)
+    {
+      encoded += (char)((0x20 | (bits & 0x1f)) + 63);
+      bits >>= 5;
+    }
+  encoded += (char)(bits + 63);
+
+  previous = value;
+
+}
+
+void geoMetadata::addFootprintMeta(OGRGeometry *footprint, OGRCoordinateTransformation *hTransform) {
+
+  OGREnvelope envelope;
+  footprint->getEnvelope(&envelope);
+  
+  //simplify in natural coordinates until the vertex budget is met
+  OGRGeometry *hSimplified = footprint->clone();
+  double tolerance = std::max(envelope.MaxX - envelope.MinX, envelope.MaxY - envelope.MinY) / 1000.0;
+  
+  for(int i = 0; i < 20 && countVertices(hSimplified) > footprintMaxVertices; i++)
+    {
+      OGRGeometry *hNext = footprint->SimplifyPreserveTopology(tolerance);
+      if(hNext == NULL)
+	break;
+      delete hSimplified;
+      hSimplified = hNext;
+      tolerance *= 2.0;
+    }
+  
+  std::vector<OGRLinearRing *> rings;
+  collectRings(hSimplified, rings, 0);
+  
+  if(countVertices(hSimplified) > footprintMaxVertices || rings.empty())
+    {
+      delete hSimplified;
+      return;
+    }
+  
+  //re-project every vertex with a single transform call
+  if(NULL != hTransform)
+    {
+      std::vector<double> x, y;
+      for(size_t r = 0; r < rings.size(); r++)
+	for(int i = 0; i < rings[r]->getNumPoints(); i++)
+	  {
+	    x.push_back(rings[r]->getX(i));
+	    y.push_back(rings[r]->getY(i));
+	  }
+      
+      if(!hTransform->Transform((int)x.size(), &x[0], &y[0]))
+	{
+	  delete hSimplified;
+	  return;
+	}
+      
+      size_t k = 0;
+      for(size_t r = 0; r < rings.size(); r++)
+	for(int i = 0; i < rings[r]->getNumPoints(); i++, k++)
+	  rings[r]->setPoint(i, x[k], y[k]);
+    }
+  
+  //compact WKT with fixed precision, exportToWkt would use all digits
+  std::string wkt = "MULTIPOLYGON (";
+  std::string polyline;
+  char coord[64];
+  OGRGeometryCollection *hPolygons = NULL;
+  
+  if(wkbFlatten(hSimplified->getGeometryType()) != wkbPolygon)
+    hPolygons = (OGRGeometryCollection *) hSimplified;
+  
+  int nPolygons = hPolygons != NULL ? hPolygons->getNumGeometries() : 1;
+  for(int p = 0; p < nPolygons; p++)
+    {
+      OGRGeometry *hPolygon = hPolygons != NULL ? hPolygons->getGeometryRef(p) : hSimplified;
+      std::vector<OGRLinearRing *> polygonRings;
+      collectRings(hPolygon, polygonRings, 0);
+      
+      wkt += p > 0 ? ",(" : "(";
+      for(size_t r = 0; r < polygonRings.size(); r++)
+	{
+	  wkt += r > 0 ? ",(" : "(";
+	  for(int i = 0; i < polygonRings[r]->getNumPoints(); i++)
+	    {
+	      snprintf(coord, sizeof coord, "%s%.6f %.6f", i > 0 ? "," : "",
+		       polygonRings[r]->getX(i), polygonRings[r]->getY(i));
+	      wkt += coord;
+	    }
+	  wkt += ")";
+	}
+      wkt += ")";
+      
+      //one polyline per exterior ring, space separated
+      if(!polygonRings.empty())
+	{
+	  double prevLat = 0.0, prevLon = 0.0;
+	  if(!polyline.empty())
+	    polyline += " ";
+	  for(int i = 0; i < polygonRings[0]->getNumPoints(); i++)
+	    {
+	      encodePolylineValue(polygonRings[0]->getY(i), prevLat, polyline);
+	      encodePolylineValue(polygonRings[0]->getX(i), prevLon, polyline);
+	    }
+	}
+    }
+  wkt += ")";
+  
+  delete hSimplified;
+  
+  char metaname[128];
+  
+  if(wkt.size() < maxValueLength)
+    {
+      snprintf(metaname, sizeof metaname, "footprint");
+      addMeta(metaname, (char *) wkt.c_str());
+    }
+  
+  if(polyline.size() < maxValueLength)
+    {
+      snprintf(metaname, sizeof metaname, "footprint_polyline");
+      addMeta(metaname, (char *) polyline.c_str());
+    }
+  
+}
+
+void geoMetadata::extractSubdatasets(int withDescriptions) {
+
+  //subdatasets are listed on the dataset, not on the driver
+  char **papszSubdatasets = poDataset->GetMetadata( "SUBDATASETS" );
+  int nSubdatasets = CSLCount( papszSubdatasets ) / 2;
+  
+  if ( nSubdatasets <= 0)
+    return;
   
-  //desired spatial reference
-  OGRSpatialReference *targetSpatialRef = new OGRSpatialReference();
-  targetSpatialRef->importFromEPSG(4326);
+  std::vector<std::string> names(nSubdatasets), descs(nSubdatasets);
+  std::vector<rasterBounds> results(nSubdatasets);
+  char szKeyName[1024];
+  const char *pszValue;
+  int i;
   
-  //get the first layer
-  OGRLayer *hLayer = poDS->GetLayer(0);
+  for (i = 0; i < nSubdatasets; i++)
+    {
+      snprintf( szKeyName, sizeof(szKeyName), "SUBDATASET_%d_NAME", i + 1 );
+      pszValue = CSLFetchNameValue( papszSubdatasets, szKeyName );
+      names[i] = pszValue != NULL ? pszValue : "";
+      
+      snprintf( szKeyName, sizeof(szKeyName), "SUBDATASET_%d_DESC", i + 1 );
+      pszValue = CSLFetchNameValue( papszSubdatasets, szKeyName );
+      descs[i] = pszValue != NULL ? pszValue : "";
+    }
   
-  //get layer's projection and extents
-  hSpatialRef = hLayer->GetSpatialRef();
+  //open every subdataset on a bounded pool, the transforms of each
+  //worker's context are reused since subdatasets of a container
+  //mostly share one projection. Subdatasets are opened only once,
+  //so they bypass the handle cache
+  runWorkers(nSubdatasets, [&names, &results](int iSub, int) {
+      GDALDataset *hSub = (GDALDataset *) GDALOpen( names[iSub].c_str(), GA_ReadOnly );
+      if(hSub == NULL)
+	return;
+      
+      computeRasterBounds(hSub, geoContext::current().transforms(), results[iSub]);
+      GDALClose((GDALDatasetH) hSub);
+    });
   
-  snprintf(metaname, sizeof metaname, "projection");
-  snprintf(metavalue, sizeof metavalue, "%s", (char *)hSpatialRef->GetAttrValue("PROJECTION",0));
-  addMeta(metaname,metavalue);
+  //queue everything and write it in a single pass
+  for (i = 0; i < nSubdatasets; i++)
+    {
+      if(withDescriptions)
+	{
+	  addMetaUnit("description", descs[i].c_str(), names[i].c_str());
+	  addMetaUnit("title", descs[i].c_str(), names[i].c_str());
+	  addMetaUnit("subject", names[i].c_str(), names[i].c_str());
+	}
+      
+      //xsize,ysize,bands[,lonmin,latmin,lonmax,latmax]
+      if(results[i].xsize > 0)
+	{
+	  char metavalue[256];
+	  
+	  if(results[i].georeferenced)
+	    snprintf(metavalue, sizeof metavalue, "%d,%d,%d,%f,%f,%f,%f",
+		     results[i].xsize, results[i].ysize, results[i].bands,
+		     results[i].lonmin, results[i].latmin, results[i].lonmax, results[i].latmax);
+	  else
+	    snprintf(metavalue, sizeof metavalue, "%d,%d,%d",
+		     results[i].xsize, results[i].ysize, results[i].bands);
+	  
+	  addMetaUnit("subdataset", metavalue, names[i].c_str());
+	}
+    }
   
-  hLayer->GetExtent(hExtent);
+  rei->status = setMetaUnits();
   
-  poCT = OGRCreateCoordinateTransformation(hSpatialRef,targetSpatialRef) ;
+}
+
+int geoMetadata::readQuicklookBand(const char *path, int iBand, int xSize, int ySize, GByte *pixels) {
+
+  //GDAL datasets are not thread-safe, each band reader uses its own
+  GDALDataset *hDataset = geoContext::current().openRaster( path );
+  if(hDataset == NULL)
+    return 0;
   
-  double x1,y1,x2,y2,x11,y11,x21,y21;
-  int transformed = 0;
+  GDALRasterBand *hBand = hDataset->GetRasterBand(iBand);
+  GDALRasterBand *hSource = hBand;
   
-  x1 = hExtent->MinX;
-  y1 = hExtent->MinY;
-  x2 = hExtent->MaxX;
-  y2 = hExtent->MaxY;
+  //smallest overview still at least as large as the thumbnail,
+  //otherwise GDAL decimates while reading the full resolution band
+  for(int i = 0; hBand != NULL && i < hBand->GetOverviewCount(); i++)
+    {
+      GDALRasterBand *hOverview = hBand->GetOverview(i);
+      if(hOverview != NULL && hOverview->GetXSize() >= xSize && hOverview->GetYSize() >= ySize &&
+	 hOverview->GetXSize() < hSource->GetXSize())
+	hSource = hOverview;
+    }
   
-  x11 = x1;
-  x21 = x2;
-  y11 = y1;
-  y21 = y2;
+  std::vector<float> values((size_t)xSize * ySize);
   
-  //extract natural and re-projected extents
-  snprintf(metaname, sizeof metaname, "northlimit");
-  snprintf(metavalue, sizeof metavalue, "%f", y2);
-  addMeta(metaname, metavalue);
+  if(hBand == NULL ||
+     hSource->RasterIO(GF_Read, 0, 0, hSource->GetXSize(), hSource->GetYSize(), &values[0], xSize, ySize, GDT_Float32, 0, 0) != CE_None)
+    return 0;
   
-  snprintf(metaname, sizeof metaname, "eastlimit");
-  snprintf(metavalue, sizeof metavalue, "%f", x2);
-  addMeta(metaname, metavalue);
+  int hasNoData = 0;
+  float nodata = (float) hBand->GetNoDataValue(&hasNoData);
   
-  snprintf(metaname, sizeof metaname, "westlimit");
-  snprintf(metavalue, sizeof metavalue, "%f", x1);
-  addMeta(metaname, metavalue);
+  //percentile stretch computed from a sample of the valid pixels
+  std::vector<GByte> valid(values.size());
+  std::vector<float> sample;
+  size_t step = std::max((size_t)1, values.size() / 4096);
   
-  snprintf(metaname, sizeof metaname, "southlimit");
-  snprintf(metavalue, sizeof metavalue, "%f", y1);
-  addMeta(metaname, metavalue);
+  buildValidMask(&values[0], &valid[0], values.size(), hasNoData ? nodata : NAN);
+  for(size_t i = 0; i < values.size(); i += step)
+    if(valid[i])
+      sample.push_back(values[i]);
   
-  if(NULL != poCT)
+  if(sample.empty())
     {
-      if(poCT->Transform(1,&x11,&y11))
-	{
-	  if (poCT->Transform(1,&x21,&y21))
-	    {
-	      transformed = 1;
-	      snprintf(metaname, sizeof metaname, "latmax");
-	      snprintf(metavalue, sizeof metavalue, "%f", y21);
-	      addMeta(metaname, metavalue);
-	      
-	      snprintf(metaname, sizeof metaname, "lonmax");
-	      snprintf(metavalue, sizeof metavalue, "%f", x21);
-	      addMeta(metaname, metavalue);
-	      
-	      snprintf(metaname, sizeof metaname, "lonmin");
-	      snprintf(metavalue, sizeof metavalue, "%f", x11);
-	      addMeta(metaname, metavalue);
-	      
-	      snprintf(metaname, sizeof metaname, "latmin");
-	      snprintf(metavalue, sizeof metavalue, "%f", y11);
-	      addMeta(metaname, metavalue);
-	    }
-	}
+      memset(pixels, 0, values.size());
+      return 1;
     }
   
-  if(!transformed)
+  size_t lowIndex = (size_t)(sample.size() * quicklookClip);
+  size_t highIndex = sample.size() - 1 - lowIndex;
+  std::nth_element(sample.begin(), sample.begin() + lowIndex, sample.end());
+  float low = sample[lowIndex];
+  std::nth_element(sample.begin(), sample.begin() + highIndex, sample.end());
+  float high = sample[highIndex];
+  float scale = high > low ? 254.0f / (high - low) : 0.0f;
+  
+  //0 is kept for nodata, extractQuicklook makes it transparent
+  for(size_t i = 0; i < values.size(); i++)
     {
-      snprintf(metaname, sizeof metaname, "latmax");
-      snprintf(metavalue, sizeof metavalue, "%f", y2);
-      addMeta(metaname, metavalue);
-      
-      snprintf(metaname, sizeof metaname, "lonmax");
-      snprintf(metavalue, sizeof metavalue, "%f", x2);
-      addMeta(metaname, metavalue);
-      
-      snprintf(metaname, sizeof metaname, "lonmin");
-      snprintf(metavalue, sizeof metavalue, "%f", x1);
-      addMeta(metaname, metavalue);
-      
-      snprintf(metaname, sizeof metaname, "latmin");
-      snprintf(metavalue, sizeof metavalue, "%f", y1);
-      addMeta(metaname, metavalue);
+      float v = (values[i] - low) * scale + 1.0f;
+      pixels[i] = !valid[i] ? 0 : v < 1.0f ? 1 : v > 255.0f ? 255 : (GByte) v;
     }
   
-  return;
+  return 1;
   
 }
 
-void geoMetadata::extractMetaShp()
-{
-  //if the dataset object is NULL just return
-  //constructor initializes it and may fail to do so
-  //if the shapefile dataset is incompletely uploaded
-  //requires a shx, shp, prj and dbf file atleast
-  if( poDS == NULL )
+void geoMetadata::extractQuicklook() {
+
+  //collected results have no object to attach a companion to
+  if(sink != NULL)
+    return;
+
+  std::string format = getOption("quicklook");
+  
+  //NetCDF and HDF bands are records along the unlimited dimension, and
+  //multi-variable containers have none, so those are rendered grey from
+  //band 1 of the first subdataset; only GeoTIFF bands are colours
+  int isTiff = strcmp(geoExt, ".tif") == 0;
+  std::string source = filePath;
+  GDALDataset *hSource = poDataset;
+  const char *pszSubdataset = isTiff ? NULL : poDataset->GetMetadataItem("SUBDATASET_1_NAME", "SUBDATASETS");
+  
+  if(pszSubdataset != NULL)
     {
-      rodsLog(LOG_ERROR, "Error occurred during shapefile metadata extraction: null dataset. Make sure atleast the .prj, .shp, .shx and .dbf files are present.");
-      rei->status = -1;
-      return;
+      source = pszSubdataset;
+      hSource = geoContext::current().openRaster(source.c_str());
+      if(hSource == NULL)
+	return;
     }
   
-  extractVectorBasicMeta();
-  
-  char subject[2700];
-  char metaname[128];
+  //a second band would be written as alpha, so it is RGB or grey
+  int nBands = hSource->GetRasterCount() >= 3 && isTiff ? 3 : hSource->GetRasterCount() >= 1 ? 1 : 0;
+  int xsize = hSource->GetRasterXSize();
+  int ysize = hSource->GetRasterYSize();
   
-  //get the first layer
-  OGRLayer *hLayer = poDS->GetLayer(0);
+  if(nBands == 0 || xsize <= 0 || ysize <= 0)
+    return;
   
-  //get the definition of a feature from the layer
-  OGRFeatureDefn *hFDefn = hLayer->GetLayerDefn();
-  int iField;
+  const char *pszDriver = format == "webp" ? "WEBP" : "PNG";
+  const char *pszExtension = format == "webp" ? "webp" : "png";
+  GDALDriver *hOutDriver = GetGDALDriverManager()->GetDriverByName(pszDriver);
+  GDALDriver *hMemDriver = GetGDALDriverManager()->GetDriverByName("MEM");
   
-  //each feature has attribute fields
-  //extract the names of these attributes to be used as metadata
-  //for search
-  for( iField = 0; iField < hFDefn->GetFieldCount(); iField++ )
+  if(hOutDriver == NULL || hMemDriver == NULL)
     {
-      OGRFieldDefn *hFieldDefn = hFDefn->GetFieldDefn( iField );
-      
-      if(iField == 0)
-	{
-	  strcpy(subject,hFieldDefn->GetNameRef());
-	}
-      else
+      rodsLog(LOG_NOTICE, "msiExtractGeoMeta: %s driver unavailable, no quicklook for %s", pszDriver, objName);
+      return;
+    }
+  
+  //thumbnail size depends only on the aspect ratio, so the cost of
+  //the stage does not grow with the raster
+  double scale = (double)quicklookSize / std::max(xsize, ysize);
+  if(scale > 1.0)
+    scale = 1.0;
+  int xSize = std::max(1, (int)(xsize * scale));
+  int ySize = std::max(1, (int)(ysize * scale));
+  
+  std::vector<std::vector<GByte> > pixels(nBands, std::vector<GByte>((size_t)xSize * ySize));
+  std::vector<int> ok(nBands, 0);
+  
+  runWorkers(nBands, [&source, xSize, ySize, &pixels, &ok](int b, int) {
+      ok[b] = readQuicklookBand(source.c_str(), b + 1, xSize, ySize, &pixels[b][0]);
+    });
+  
+  if(std::find(ok.begin(), ok.end(), 0) != ok.end())
+    return;
+  
+  //pixels that are nodata in any band (0 after the stretch) become
+  //transparent through an alpha band, which is left out without them
+  std::vector<GByte> alpha((size_t)xSize * ySize, 255);
+  int hasAlpha = 0;
+  for(size_t i = 0; i < alpha.size(); i++)
+    for(int b = 0; b < nBands; b++)
+      if(pixels[b][i] == 0)
 	{
-	  strcat(subject,",");
-	  strcat(subject,hFieldDefn->GetNameRef());
+	  alpha[i] = 0;
+	  hasAlpha = 1;
 	}
-    }
   
-  snprintf(metaname, sizeof metaname, "subject");
-  addMeta(metaname, subject);
+  //WebP only encodes RGB(A), grey is repeated into all three channels
+  int nColors = format == "webp" ? 3 : nBands;
+  GDALDataset *hThumb = hMemDriver->Create("", xSize, ySize, nColors + hasAlpha, GDT_Byte, NULL);
+  if(hThumb == NULL)
+    return;
   
-  rei->status = setMeta();
+  for(int b = 0; b < nColors; b++)
+    hThumb->GetRasterBand(b + 1)->RasterIO(GF_Write, 0, 0, xSize, ySize, &pixels[b % nBands][0], xSize, ySize, GDT_Byte, 0, 0);
   
-  return;
-}
-
-void geoMetadata::extractRasterBasicMeta() {
-
-  char metaname[128];
-  char metavalue[128];
+  if(hasAlpha)
+    {
+      GDALRasterBand *hAlpha = hThumb->GetRasterBand(nColors + 1);
+      hAlpha->SetColorInterpretation(GCI_AlphaBand);
+      hAlpha->RasterIO(GF_Write, 0, 0, xSize, ySize, &alpha[0], xSize, ySize, GDT_Byte, 0, 0);
+    }
   
-  GDALDriver *hDriver = poDataset->GetDriver();
+  //encode in memory and store as a companion data object
+  char vsiPath[128], quicklookPath[MAX_NAME_LEN];
+  snprintf(vsiPath, sizeof vsiPath, "/vsimem/quicklook_%p.%s", (void *)this, pszExtension);
+  snprintf(quicklookPath, sizeof quicklookPath, "%s.quicklook.%s", objName, pszExtension);
   
-  //extract raster format 
-  snprintf(metaname, sizeof metaname, "format");
-  snprintf(metavalue, sizeof metavalue, "%s", hDriver->GetMetadataItem(GDAL_DMD_EXTENSION));
-  addMeta(metaname, metavalue);
+  GDALDataset *hOut = hOutDriver->CreateCopy(vsiPath, hThumb, FALSE, NULL, NULL, NULL);
+  GDALClose((GDALDatasetH) hThumb);
   
-  snprintf(metaname, sizeof metaname, "type");
-  snprintf(metavalue, sizeof metavalue, "geospatial");
-  addMeta(metaname, metavalue);
+  if(hOut == NULL)
+    return;
+  GDALClose((GDALDatasetH) hOut);
   
-  snprintf(metaname, sizeof metaname, "language");
-  snprintf(metavalue, sizeof metavalue, "%s", hDriver->GetMetadataItem(GDAL_DMD_EXTENSION));
-  addMeta(metaname, metavalue);
+  vsi_l_offset len = 0;
+  GByte *data = VSIGetMemFileBuffer(vsiPath, &len, FALSE);
   
-  extractRasterBounds();
+  if(data != NULL && putQuicklook(quicklookPath, data, (int)len) >= 0)
+    {
+      addMetaUnit("quicklook", quicklookPath, pszExtension);
+      setMetaUnits();
+    }
   
-  return;
+  VSIUnlink(vsiPath);
   
 }
 
-void geoMetadata::extractRasterBounds() {
+int geoMetadata::putQuicklook(const char *objPath, const GByte *data, int len) {
 
-  char metaname[128];
-  char metavalue[128];
+  //companion objects need a server connection
+  if(sink != NULL)
+    return -1;
   
-  int xsize = poDataset->GetRasterXSize();
-  int ysize = poDataset->GetRasterYSize();
+  //create, write and close
+  catalogCalls += 3;
   
-  snprintf(metaname, sizeof metaname, "xsize");
-  snprintf(metavalue, sizeof metavalue, "%d",xsize);
-  addMeta(metaname, metavalue);
+  if(catalog != NULL)
+    {
+      catalog->putObject(objPath, len);
+      return len;
+    }
   
-  snprintf(metaname, sizeof metaname, "ysize");
-  snprintf(metavalue, sizeof metavalue, "%d",ysize);
-  addMeta(metaname, metavalue);
+#ifndef GEOMETA_STANDALONE
+  dataObjInp_t dataObjInp;
+  openedDataObjInp_t openedDataObjInp;
+  bytesBuf_t dataObjWriteInpBBuf;
+  int status;
   
-  //set coverage information
-  //includes north,east,west and southlimit and projection if any
-  //will also store bounds in lat-lon to make it easier to search
-  if( poDataset->GetProjectionRef() != NULL )
+  bzero (&dataObjInp, sizeof (dataObjInp));
+  snprintf(dataObjInp.objPath, sizeof dataObjInp.objPath, "%s", objPath);
+  dataObjInp.dataSize = len;
+  //re-extraction replaces the previous quicklook
+  addKeyVal(&dataObjInp.condInput, FORCE_FLAG_KW, "");
+  
+  int fd = rsDataObjCreate(rei->rsComm, &dataObjInp);
+  clearKeyVal(&dataObjInp.condInput);
+  
+  if(fd < 0)
     {
-      OGRSpatialReference *hSpatialRef, *targetSpatialRef;
-      char *pszProjection;
-      double adfGeoTransform[6];
-      
-      pszProjection = (char *)poDataset->GetProjectionRef();
-      hSpatialRef = new OGRSpatialReference( pszProjection );
-      targetSpatialRef = hSpatialRef->CloneGeogCS();
-      
-      OGRCoordinateTransformation *hTransform = OGRCreateCoordinateTransformation(hSpatialRef,targetSpatialRef);
-      
-      if( poDataset->GetGeoTransform( adfGeoTransform ) == CE_None )
-	{ //is georeferenced
-	  double dfGeoX,dfGeoY,northlimit,eastlimit,westlimit,southlimit,northlimit_latlon,eastlimit_latlon,westlimit_latlon,southlimit_latlon;
-	  
-	  dfGeoX = adfGeoTransform[0] + adfGeoTransform[1] * 0.0 + adfGeoTransform[2] * 0.0;
-	  dfGeoY = adfGeoTransform[3] + adfGeoTransform[4] * 0.0 + adfGeoTransform[5] * 0.0;
-	  
-	  northlimit = dfGeoY;
-	  westlimit = dfGeoX;
-	  
-	  if(NULL != hTransform)
-	    {
-	      hTransform->Transform(1,&dfGeoX,&dfGeoY);
-	      northlimit_latlon = dfGeoY;
-	      westlimit_latlon = dfGeoX;
-	    }
-	  
-	  dfGeoX = adfGeoTransform[0] + adfGeoTransform[1] * 0.0 + adfGeoTransform[2] * ysize;
-	  dfGeoY = adfGeoTransform[3] + adfGeoTransform[4] * 0.0 + adfGeoTransform[5] * ysize;
-	  
-	  if(dfGeoX < westlimit)
-	    westlimit = dfGeoX;
-	  southlimit = dfGeoY;
-	  
-	  if(NULL != hTransform)
-	    {
-	      hTransform->Transform(1,&dfGeoX,&dfGeoY);
-	      if(dfGeoX < westlimit_latlon)
-		westlimit_latlon = dfGeoX;
-	      southlimit_latlon = dfGeoY;
-	    }
-	  
-	  dfGeoX = adfGeoTransform[0] + adfGeoTransform[1] * xsize + adfGeoTransform[2] * 0.0;
-	  dfGeoY = adfGeoTransform[3] + adfGeoTransform[4] * xsize + adfGeoTransform[5] * 0.0;
-	  
-	  eastlimit = dfGeoX;
-	  if(dfGeoY > northlimit)
-	    northlimit = dfGeoY;
-	  
-	  if(NULL != hTransform)
-	    {
-	      hTransform->Transform(1,&dfGeoX,&dfGeoY);
-	      eastlimit_latlon = dfGeoX;
-	      if(dfGeoY > northlimit_latlon)
-		northlimit_latlon = dfGeoY;
-	    }
-	  
-	  dfGeoX = adfGeoTransform[0] + adfGeoTransform[1] * xsize + adfGeoTransform[2] * ysize;
-	  dfGeoY = adfGeoTransform[3] + adfGeoTransform[4] * xsize + adfGeoTransform[5] * ysize;
-	  
-	  if(dfGeoX > eastlimit)
-	    eastlimit = dfGeoX;
-	  if(dfGeoY < southlimit)
-	    southlimit = dfGeoY;
-	  
-	  if(NULL != hTransform)
-	    {
-	      hTransform->Transform(1,&dfGeoX,&dfGeoY);
-	      if(dfGeoX > eastlimit_latlon)
-		eastlimit_latlon = dfGeoX;
-	      if(dfGeoY < southlimit_latlon)
-		southlimit_latlon = dfGeoY;
-	    }
-	  
-	  //projection attribute for coverage
-	  snprintf(metaname, sizeof metaname, "projection");
-	  snprintf(metavalue, sizeof metavalue, "%s", hSpatialRef->GetAttrValue("PROJECTION",0));
-	  addMeta(metaname, metavalue);
-	  
-	  snprintf(metaname, sizeof metaname, "northlimit");
-	  snprintf(metavalue, sizeof metavalue, "%f", northlimit);
-	  addMeta(metaname, metavalue);
-	  
-	  snprintf(metaname, sizeof metaname, "eastlimit");
-	  snprintf(metavalue, sizeof metavalue, "%f", eastlimit);
-	  addMeta(metaname, metavalue);
-	  
-	  snprintf(metaname, sizeof metaname, "westlimit");
-	  snprintf(metavalue, sizeof metavalue, "%f", westlimit);
-	  addMeta(metaname, metavalue);
-	  
-	  snprintf(metaname, sizeof metaname, "southlimit");
-	  snprintf(metavalue, sizeof metavalue, "%f", southlimit);
-	  addMeta(metaname, metavalue);
-	  
-	  if(NULL != hTransform)
-	    {
-	      snprintf(metaname, sizeof metaname, "latmax");
-	      snprintf(metavalue, sizeof metavalue, "%f", northlimit_latlon);
-	      addMeta(metaname, metavalue);
-	      
-	      snprintf(metaname, sizeof metaname, "lonmax");
-	      snprintf(metavalue, sizeof metavalue, "%f", eastlimit_latlon);
-	      addMeta(metaname, metavalue);
-	      
-	      snprintf(metaname, sizeof metaname, "lonmin");
-	      snprintf(metavalue, sizeof metavalue, "%f", westlimit_latlon);
-	      addMeta(metaname, metavalue);
-	      
-	      snprintf(metaname, sizeof metaname, "latmin");
-	      snprintf(metavalue, sizeof metavalue, "%f", southlimit_latlon);
-	      addMeta(metaname, metavalue);
-	      
-	    }
-	  else
-	    {
-	      snprintf(metaname, sizeof metaname, "latmax");
-	      snprintf(metavalue, sizeof metavalue, "%f", northlimit);
-	      addMeta(metaname, metavalue);
-	      
-	      snprintf(metaname, sizeof metaname, "lonmax");
-	      snprintf(metavalue, sizeof metavalue, "%f", eastlimit);
-	      addMeta(metaname, metavalue);
-	      
-	      snprintf(metaname, sizeof metaname, "lonmin");
-	      snprintf(metavalue, sizeof metavalue, "%f", westlimit);
-	      addMeta(metaname, metavalue);
-	      
-	      snprintf(metaname, sizeof metaname, "latmin");
-	      snprintf(metavalue, sizeof metavalue, "%f", southlimit);
-	      addMeta(metaname, metavalue);
-	      
-	    }
-	  
-	}
+      rodsLog(LOG_ERROR, "msiExtractGeoMeta: failed to create %s, status = %d", objPath, fd);
+      return fd;
     }
+  
+  bzero (&openedDataObjInp, sizeof (openedDataObjInp));
+  openedDataObjInp.l1descInx = fd;
+  openedDataObjInp.len = len;
+  dataObjWriteInpBBuf.buf = (void *) data;
+  dataObjWriteInpBBuf.len = len;
+  
+  status = rsDataObjWrite(rei->rsComm, &openedDataObjInp, &dataObjWriteInpBBuf);
+  if(status < 0)
+    rodsLog(LOG_ERROR, "msiExtractGeoMeta: failed to write %s, status = %d", objPath, status);
+  
+  rsDataObjClose(rei->rsComm, &openedDataObjInp);
+  
+  return status;
+#else
+  return -1;
+#endif
+  
 }
 
 /*the extraction of description, subject & title will differ
@@ -552,10 +2291,9 @@ void geoMetadata::extractMetaGeoTiff()
   extractRasterBasicMeta();
   
   GDALDriver *hDriver = poDataset->GetDriver();
-  modAVUMetadataInp_t modAVUMetadataInp;
   
   char **geoMetadata = hDriver->GetMetadata( NULL );
-  int i,j;
+  int i;
   char metaname[128];
   char metavalue[512];
   
@@ -584,77 +2322,361 @@ void geoMetadata::extractMetaGeoTiff()
 	}
     }
   
-  //Call geoMetadata::setMeta to set previously extracted metadata to 
-  //the iRODS file
+  //Call geoMetadata::setMeta to set previously extracted metadata to 
+  //the iRODS file
+  
+  rei->status  = setMeta();
+  
+  if(rei->status >= 0)
+    extractSubdatasets(1);
+  
+  if(optionEnabled("quicklook"))
+    extractQuicklook();
+  
+  return;
+  
+}
+
+int geoMetadata::readTextAttribute(int ncid, int varid, const char *name, std::string &value) {
+
+  nc_type atttype;
+  size_t attlen;
+
+  if(nc_inq_att(ncid, varid, name, &atttype, &attlen) != NC_NOERR || atttype != NC_CHAR)
+    return 0;
+
+  std::vector<char> attval(attlen + 1, '\0');
+  if(nc_get_att_text(ncid, varid, name, &attval[0]) != NC_NOERR)
+    return 0;
+
+  value = &attval[0];
+  return 1;
+
+}
+
+std::string geoMetadata::inventoryField(const std::string &field) {
+
+  //';' separates inventory items, '=' name from long name, '|' and
+  //',' the parts of a layer item. A '\\' makes the next character
+  //literal, msiExpandGeoMetaVariables undoes this escaping
+  std::string out;
+
+  for(size_t i = 0; i < field.size(); i++)
+    {
+      if(field[i] == '\\' || field[i] == ';' || field[i] == '=' || field[i] == '|' || field[i] == ',')
+	out += '\\';
+      out += field[i];
+    }
+
+  return out;
+
+}
+
+int geoMetadata::readUnlimitedCoverage(int ncid, int unlimdimid, size_t from, unlimitedCoverage &coverage) {
+
+  char dimname[NC_MAX_NAME + 1];
+  int varid, ndims;
+  double fill = NC_FILL_DOUBLE;
+
+  if(nc_inq_dim(ncid, unlimdimid, dimname, &coverage.length) != NC_NOERR)
+    return -1;
+
+  coverage.dimension = dimname;
+
+  //the coordinate variable is the 1-D variable named after the dimension
+  if(from >= coverage.length || nc_inq_varid(ncid, dimname, &varid) != NC_NOERR ||
+     nc_inq_varndims(ncid, varid, &ndims) != NC_NOERR || ndims != 1)
+    return 0;
+
+  readTextAttribute(ncid, varid, "units", coverage.units);
+  nc_get_att_double(ncid, varid, "_FillValue", &fill);
+
+  //records not written yet hold the fill value
+  std::vector<double> values;
+  size_t start, count;
+
+  for(start = from; start < coverage.length; start += count)
+    {
+      count = std::min(coverage.length - start, coordinateBlockSize);
+      values.resize(count);
+      if(nc_get_vara_double(ncid, varid, &start, &count, &values[0]) != NC_NOERR)
+	return -1;
+
+      for(size_t i = 0; i < count; i++)
+	{
+	  if(values[i] == fill || !std::isfinite(values[i]))
+	    continue;
+	  if(!coverage.hasRange || values[i] < coverage.min)
+	    coverage.min = values[i];
+	  if(!coverage.hasRange || values[i] > coverage.max)
+	    coverage.max = values[i];
+	  coverage.hasRange = 1;
+	}
+    }
+
+  return 0;
+
+}
+
+std::string geoMetadata::unlimitedMarker(int ncid, int unlimdimid, size_t records) {
+
+  //an append changes neither the layout nor the records already
+  //written, a replaced file almost always changes one of them. Sizes
+  //and header bytes change on every append, so they cannot be used
+  char name[NC_MAX_NAME + 1];
+  char value[64];
+  int ndims, nvars, ngatts, unlimited, varndims, varid;
+  size_t length, index;
+  double coordinate;
+  std::string layout;
+
+  if(nc_inq(ncid, &ndims, &nvars, &ngatts, &unlimited) != NC_NOERR)
+    return "";
+
+  for(int d = 0; d < ndims; d++)
+    {
+      nc_inq_dim(ncid, d, name, &length);
+      snprintf(value, sizeof value, "=%lu\n", d == unlimdimid ? 0UL : (unsigned long) length);
+      layout += std::string(name) + value;
+    }
+
+  for(int v = 0; v < nvars; v++)
+    {
+      nc_inq_varname(ncid, v, name);
+      nc_inq_varndims(ncid, v, &varndims);
+      snprintf(value, sizeof value, ":%d\n", varndims);
+      layout += std::string(name) + value;
+    }
+
+  //first and last of the records covered by the marker
+  nc_inq_dimname(ncid, unlimdimid, name);
+  if(records > 0 && nc_inq_varid(ncid, name, &varid) == NC_NOERR)
+    {
+      index = 0;
+      if(nc_get_var1_double(ncid, varid, &index, &coordinate) == NC_NOERR)
+	{
+	  snprintf(value, sizeof value, "%.17g\n", coordinate);
+	  layout += value;
+	}
+      index = records - 1;
+      if(nc_get_var1_double(ncid, varid, &index, &coordinate) == NC_NOERR)
+	{
+	  snprintf(value, sizeof value, "%.17g\n", coordinate);
+	  layout += value;
+	}
+    }
+
+  snprintf(value, sizeof value, "%lu", (unsigned long) records);
+  layout += value;
+
+  return sha2Of(layout);
+
+}
+
+void geoMetadata::addUnlimitedMeta(const unlimitedCoverage &coverage, const std::string &marker)
+{
+  char metavalue[64];
+  
+  //single valued on every path, including results of the daemon
+  snprintf(metavalue, sizeof metavalue, "%lu", (unsigned long) coverage.length);
+  replaceMetaUnit("unlimited_length", metavalue, coverage.dimension.c_str());
+  replaceMetaUnit("unlimited_marker", marker.c_str(), coverage.dimension.c_str());
+  
+  if(!coverage.hasRange)
+    return;
+  
+  //in the units of the coordinate variable, e.g. days since 1900-01-01
+  const char *unit = coverage.units.empty() ? coverage.dimension.c_str() : coverage.units.c_str();
+  
+  snprintf(metavalue, sizeof metavalue, "%f", coverage.min);
+  replaceMetaUnit("unlimited_min", metavalue, unit);
+  
+  snprintf(metavalue, sizeof metavalue, "%f", coverage.max);
+  replaceMetaUnit("unlimited_max", metavalue, unit);
+}
+
+int geoMetadata::extractNetCDFAppend()
+{
+  //needs what an earlier extraction stored, so only with a catalog
+  if(sink != NULL || strcmp(geoExt, ".nc") != 0)
+    return -1;
+  
+  std::vector<geoAVU> stored;
+  const geoAVU *length = NULL, *marker = NULL, *minimum = NULL, *maximum = NULL;
+  std::vector<const geoAVU *> subdatasets;
+  int duplicates = 0;
+  
+  if(readStoredMeta("in ('unlimited_length', 'unlimited_marker', 'unlimited_min', 'unlimited_max', 'subdataset')", stored) < 0)
+    return -1;
+  
+  for(size_t i = 0; i < stored.size(); i++)
+    {
+      const geoAVU **slot = NULL;
+      if(stored[i].name == "unlimited_length")
+	slot = &length;
+      else if(stored[i].name == "unlimited_marker")
+	slot = &marker;
+      else if(stored[i].name == "unlimited_min")
+	slot = &minimum;
+      else if(stored[i].name == "unlimited_max")
+	slot = &maximum;
+      else
+	subdatasets.push_back(&stored[i]);
+      
+      if(slot != NULL && *slot != NULL)
+	duplicates++;
+      if(slot != NULL)
+	*slot = &stored[i];
+    }
+  
+  //never extracted, extracted before the marker existed, or left
+  //ambiguous by an older version; a full extraction sets them again
+  if(length == NULL || marker == NULL || duplicates > 0)
+    return -1;
+  
+  int ncid, unlimdimid;
+  size_t seen = strtoul(length->value.c_str(), NULL, 10);
+  unlimitedCoverage coverage;
+  
+  if(nc_open(filePath, NC_NOWRITE, &ncid) != NC_NOERR)
+    return -1;
+  
+  //only records past the stored length are read, anything but
+  //growth along the same dimension of the same file gets a full
+  //extraction
+  if(nc_inq_unlimdim(ncid, &unlimdimid) != NC_NOERR || unlimdimid < 0 ||
+     unlimitedMarker(ncid, unlimdimid, seen) != marker->value ||
+     readUnlimitedCoverage(ncid, unlimdimid, seen, coverage) < 0 ||
+     coverage.dimension != length->unit || coverage.length <= seen)
+    {
+      nc_close(ncid);
+      return -1;
+    }
+  
+  std::string newMarker = unlimitedMarker(ncid, unlimdimid, coverage.length);
+  nc_close(ncid);
   
-  rei->status  = setMeta();
+  //the stored range covers the records up to the stored length
+  if(minimum != NULL && maximum != NULL)
+    {
+      double storedMin = atof(minimum->value.c_str());
+      double storedMax = atof(maximum->value.c_str());
+      
+      coverage.min = coverage.hasRange ? std::min(coverage.min, storedMin) : storedMin;
+      coverage.max = coverage.hasRange ? std::max(coverage.max, storedMax) : storedMax;
+      coverage.hasRange = 1;
+    }
   
-  char **papszSubdatasets = hDriver->GetMetadata( "SUBDATASETS" );
-  int nSubdatasets = CSLCount( papszSubdatasets );
+  //records are bands of the subdatasets on the unlimited dimension,
+  //only the band count of their xsize,ysize,bands[,...] value changes
+  GDALAllRegister();
   
-  if ( nSubdatasets > 0)
-    {
-      char szKeyName[1024];
-      char *pszSubdatasetName;
-      char *pszSubdatasetDesc;
-      char op[10];
+  std::vector<std::string> updated(subdatasets.size());
+  runWorkers(subdatasets.size(), [&subdatasets, &updated](int iSub, int) {
+      GDALDataset *hSub = (GDALDataset *) GDALOpen( subdatasets[iSub]->unit.c_str(), GA_ReadOnly );
+      if(hSub == NULL)
+	return;
       
-      snprintf(op, sizeof op, "add");
+      const std::string &value = subdatasets[iSub]->value;
+      size_t third = value.find(',', value.find(',') + 1);
+      third = third == std::string::npos ? third : value.find(',', third + 1);
       
-      for (i = 1; i <= nSubdatasets/2; i++)
-	{
-	  
-	  snprintf( szKeyName, sizeof(szKeyName),
-		    "SUBDATASET_%d_NAME", i );
-	  szKeyName[sizeof(szKeyName) - 1] = '\0';
-	  pszSubdatasetName =
-	    (char *) CSLFetchNameValue( papszSubdatasets, szKeyName );
-	  snprintf( szKeyName, sizeof(szKeyName),
-		    "SUBDATASET_%d_DESC", i );
-	  szKeyName[sizeof(szKeyName) - 1] = '\0';
-	  pszSubdatasetDesc =
-	    (char *) CSLFetchNameValue( papszSubdatasets, szKeyName );
-	  
-	  
-	  bzero (&modAVUMetadataInp, sizeof (modAVUMetadataInp));
-	  modAVUMetadataInp.arg0 = op;
-	  modAVUMetadataInp.arg1 = objType;
-	  modAVUMetadataInp.arg2 = objName;
-	  snprintf(metaname, sizeof metaname, "description");
-	  modAVUMetadataInp.arg3 = metaname;
-	  modAVUMetadataInp.arg4 = pszSubdatasetDesc;
-	  modAVUMetadataInp.arg5 = pszSubdatasetName;
-	  rsModAVUMetadata(rei->rsComm, &modAVUMetadataInp);
-	  
-	  snprintf(metaname, sizeof metaname, "title");
-	  modAVUMetadataInp.arg3 = metaname;
-	  modAVUMetadataInp.arg4 = pszSubdatasetDesc;
-	  modAVUMetadataInp.arg5 = pszSubdatasetName;
-	  rsModAVUMetadata(rei->rsComm, &modAVUMetadataInp);
-	  
-	  snprintf(metaname, sizeof metaname, "subject");
-	  modAVUMetadataInp.arg3 = metaname;
-	  modAVUMetadataInp.arg4 = pszSubdatasetName;
-	  modAVUMetadataInp.arg5 = pszSubdatasetName;
-	  rsModAVUMetadata(rei->rsComm, &modAVUMetadataInp);
-	  
-	}
+      char metavalue[64];
+      snprintf(metavalue, sizeof metavalue, "%d,%d,%d",
+	       hSub->GetRasterXSize(), hSub->GetRasterYSize(), hSub->GetRasterCount());
+      updated[iSub] = metavalue + (third == std::string::npos ? std::string() : value.substr(third));
+      
+      GDALClose((GDALDatasetH) hSub);
+    });
+  
+  addUnlimitedMeta(coverage, newMarker);
+  
+  //the content changed, so does its checksum
+  std::string digest;
+  if(optionEnabled("checksum") && computeChecksum(filePath, digest) == 0)
+    addChecksumMeta(digest);
+  
+  rei->status = setMetaUnits();
+  
+  char newValue[MAX_NAME_LEN];
+  
+  for(size_t i = 0; i < subdatasets.size() && rei->status >= 0; i++)
+    {
+      if(updated[i].empty() || updated[i] == subdatasets[i]->value)
+	continue;
+      
+      snprintf(newValue, sizeof newValue, "v:%s", updated[i].c_str());
+      catalogCalls++;
+      rei->status = modifyMeta("mod", *subdatasets[i], newValue);
+      if(rei->status < 0)
+	rodsLog(LOG_ERROR, "msiExtractGeoMeta: failed to update %s of %s, status = %d", subdatasets[i]->unit.c_str(), objName, rei->status);
     }
   
-  return;
+  return 0;
+}
+
+int geoMetadata::openNetCDF(int *ncid, std::vector<char> &buffer)
+{
+  if(nc_open(filePath, NC_NOWRITE, ncid) == NC_NOERR)
+    return 0;
   
+  //the netcdf library cannot read GDAL virtual paths (archive members),
+  //those are streamed out of the archive into memory, not onto disk
+  VSIStatBufL sStat;
+  if(strncmp(filePath, "/vsi", 4) != 0 || VSIStatL(filePath, &sStat) != 0)
+    return -1;
+  
+  //every agent extracting a bundle holds one member at a time, larger
+  //members are skipped rather than read
+  std::string limitOption = getOption("netcdf_member_limit");
+  size_t limit = limitOption.empty() ? netcdfMemoryLimit : (size_t) atol(limitOption.c_str()) << 20;
+  
+  if((size_t) sStat.st_size > limit)
+    {
+      rodsLog(LOG_NOTICE, "msiExtractGeoMeta: %s exceeds the %lu MB NetCDF member limit, skipped", filePath, (unsigned long)(limit >> 20));
+      return -1;
+    }
+  
+  VSILFILE *fp = VSIFOpenL(filePath, "rb");
+  if(fp == NULL)
+    return -1;
+  
+  buffer.resize(sStat.st_size);
+  size_t nRead = buffer.empty() ? 0 : VSIFReadL(&buffer[0], 1, buffer.size(), fp);
+  VSIFCloseL(fp);
+  
+  if(buffer.empty() || nRead != buffer.size())
+    return -1;
+  
+  //the buffer has to outlive the handle
+  return nc_open_mem(filePath, NC_NOWRITE, buffer.size(), &buffer[0], ncid) == NC_NOERR ? 0 : -1;
 }
 
 void geoMetadata::extractMetaNetCDF()
 {
-  if( poDataset == NULL )
+  //GDAL's netCDF driver cannot open archive members either, for those
+  //everything comes from the netcdf library
+  if( poDataset == NULL && !archiveMember )
     {      
       rodsLog(LOG_ERROR, "Error occurred during geotiff metadata extraction : null dataset");
       rei->status = -1;
       return;
     }
   
-  extractRasterBasicMeta();
+  if( poDataset != NULL )
+    extractRasterBasicMeta();
+  else
+    {
+      char metaname[128], metavalue[128];
+      
+      snprintf(metaname, sizeof metaname, "format");
+      snprintf(metavalue, sizeof metavalue, "nc");
+      addMeta(metaname, metavalue);
+      
+      snprintf(metaname, sizeof metaname, "type");
+      snprintf(metavalue, sizeof metavalue, "geospatial");
+      addMeta(metaname, metavalue);
+    }
   
   int ncid;
   int ndims;			/* number of dimensions */
@@ -668,7 +2690,14 @@ void geoMetadata::extractMetaNetCDF()
   int dimid;			/* dimension id */
   int is_root = 1;		/* true if ncid is root group or if netCDF-3 */
   
-  nc_open(filePath,NC_NOWRITE,&ncid);
+  std::vector<char> buffer;
+  
+  if(openNetCDF(&ncid, buffer) != 0)
+    {
+      rodsLog(LOG_NOTICE, "msiExtractGeoMeta: netcdf attributes unavailable for %s", filePath);
+      rei->status = poDataset != NULL ? setMeta() : -1;
+      return;
+    }
   
   nc_inq(ncid, &ndims, &nvars, &ngatts, &xdimid);
   
@@ -708,71 +2737,538 @@ void geoMetadata::extractMetaNetCDF()
   
   rei->status  = setMeta();
   
+  //compact mode replaces the three rows per variable by a chunked
+  //name=long_name inventory and one row per distinct standard name
+  int compact = (getOption("netcdf") == "compact");
+  
   if (nvars > 0) 
     {
       
-      char *varname;
-      nc_type vartype;
-      int vardims,varnatts;
-      char op[10];
-      int status;
-      
-      snprintf(op, sizeof op, "add");
+      char varname[NC_MAX_NAME + 1];
+      std::string longName, standardName;
+      std::vector<std::string> variables;
+      std::set<std::string> standardNames;
       
       for (varid = 0; varid < nvars; varid++) {
-	varname = (char *) malloc(NC_MAX_NAME + 1);
 	nc_inq_varname(ncid, varid, varname);
 	
-	modAVUMetadataInp_t modAVUMetadataInp;
-	bzero (&modAVUMetadataInp, sizeof (modAVUMetadataInp));
-	modAVUMetadataInp.arg0 = op;
-	modAVUMetadataInp.arg1 = objType;
-	modAVUMetadataInp.arg2 = objName;
+	int hasLongName = readTextAttribute(ncid, varid, "long_name", longName);
 	
-	if (nc_inq_att(ncid, varid, "long_name", &atttype, &attlen) == NC_NOERR)
+	if(compact)
 	  {
+	    //bounded so that every variable fits into one AVU value
+	    std::string item = inventoryField(varname);
+	    if(hasLongName)
+	      item += "=" + inventoryField(longName.substr(0, maxLongName));
+	    variables.push_back(item);
 	    
-	    attval = (void *) malloc((attlen + 1) * sizeof(char) );
-	    nc_get_att(ncid, varid, "long_name", attval);
-	    ((char *)attval)[attlen] = '\0';
-	    
-	    snprintf(metaname, sizeof metaname, "description");
-	    modAVUMetadataInp.arg3 = metaname;
-	    modAVUMetadataInp.arg4 = (char *) malloc(attlen + 1);
-	    sprintf(modAVUMetadataInp.arg4, "%s", (char *)attval);
-	    modAVUMetadataInp.arg5 = (char *) malloc(NC_MAX_NAME + 1);
-	    sprintf(modAVUMetadataInp.arg5,"%s",varname);
-	    rsModAVUMetadata(rei->rsComm, &modAVUMetadataInp);
-		 
-	    snprintf(metaname, sizeof metaname, "title");
-	    modAVUMetadataInp.arg3 = metaname;
-	    modAVUMetadataInp.arg4 = (char *) malloc(attlen + 1);
-	    sprintf(modAVUMetadataInp.arg4, "%s", (char *)attval);
-	    modAVUMetadataInp.arg5 = (char *) malloc(NC_MAX_NAME + 1);
-	    sprintf(modAVUMetadataInp.arg5,"%s",varname);
-	    rsModAVUMetadata(rei->rsComm, &modAVUMetadataInp);
-	    
+	    if(readTextAttribute(ncid, varid, "standard_name", standardName) && !standardName.empty())
+	      standardNames.insert(standardName);
+	    continue;
 	  }
 	
-	snprintf(metaname, sizeof metaname, "subject");
-	modAVUMetadataInp.arg3 = metaname;
-	modAVUMetadataInp.arg4 = (char *) malloc(NC_MAX_NAME + 1);
-	sprintf(modAVUMetadataInp.arg4,"%s",varname);
-	modAVUMetadataInp.arg5 = (char *) malloc(NC_MAX_NAME + 1);
-	sprintf(modAVUMetadataInp.arg5,"%s",varname);
-	rsModAVUMetadata(rei->rsComm, &modAVUMetadataInp);
+	if (hasLongName)
+	  {
+	    addMetaUnit("description", longName.c_str(), varname);
+	    addMetaUnit("title", longName.c_str(), varname);
+	  }
 	
-	free(varname);
+	addMetaUnit("subject", varname, varname);
 	
       }         
+      
+      if(compact)
+	{
+	  //msiExpandGeoMetaVariables checks the inventory against the count
+	  snprintf(metaname, sizeof metaname, "%d", nvars);
+	  replaceMetaUnit("variablecount", metaname, "");
+	  if(addChunkedMeta("variables", variables, variableMaxChunks) < nvars)
+	    rodsLog(LOG_ERROR, "msiExtractGeoMeta: variable inventory of %s is incomplete", objName);
+	  
+	  for(std::set<std::string>::iterator it = standardNames.begin(); it != standardNames.end(); ++it)
+	    addMetaUnit("standard_name", it->c_str(), "");
+	}
+      
+      //held back after a failed setMeta, later stages must not flush them
+      if(rei->status >= 0)
+	rei->status = setMetaUnits();
+      else
+	unitMeta.clear();
+    }
+  
+  //length and coordinate range of the unlimited dimension, the
+  //starting point for extending them when records are appended
+  unlimitedCoverage coverage;
+  if(xdimid >= 0 && readUnlimitedCoverage(ncid, xdimid, 0, coverage) == 0)
+    {
+      addUnlimitedMeta(coverage, unlimitedMarker(ncid, xdimid, coverage.length));
+      if(rei->status >= 0)
+	rei->status = setMetaUnits();
+      else
+	unitMeta.clear();
     }
   
   nc_close(ncid);
   
+  if(poDataset == NULL)
+    return;
+  
+  //variables already carry description, title and subject
+  //so only add the bounds of each subdataset. Compact mode leaves
+  //them out: one row and one open (re-reading the whole header)
+  //per variable would undo the inventory
+  if(!compact && rei->status >= 0)
+    extractSubdatasets(0);
+  
+  if(optionEnabled("quicklook"))
+    extractQuicklook();
+  
   return;
 }
 
+void geoMetadata::listArchive(const std::string &vsiRoot, const std::string &dir, std::vector<std::string> &members) {
+
+  //reads the archive directory, not the member contents
+  char **papszEntries = VSIReadDir((vsiRoot + dir).c_str());
+  
+  for(int i = 0; papszEntries != NULL && papszEntries[i] != NULL; i++)
+    {
+      std::string member = dir.empty() ? papszEntries[i] : dir + "/" + papszEntries[i];
+      VSIStatBufL sStat;
+      
+      if(VSIStatL((vsiRoot + member).c_str(), &sStat) != 0)
+	continue;
+      
+      if(VSI_ISDIR(sStat.st_mode))
+	listArchive(vsiRoot, member, members);
+      else
+	members.push_back(member);
+    }
+  
+  CSLDestroy(papszEntries);
+  
+}
+
+void geoMetadata::extractMetaArchive()
+{
+  std::string name(objName);
+  std::string vsiRoot;
+  
+  //GDAL streams members out of the archive, nothing is unpacked
+  if(strcmp(geoExt,".zip") == 0)
+    vsiRoot = std::string("/vsizip/") + filePath + "/";
+  else if(strcmp(geoExt,".tar") == 0 || strcmp(geoExt,".tgz") == 0 ||
+	  (name.size() > 7 && name.compare(name.size() - 7, 7, ".tar.gz") == 0))
+    vsiRoot = std::string("/vsitar/") + filePath + "/";
+  else
+    {
+      rodsLog( LOG_ERROR, "msiExtractGeoMeta: Unsupported archive %s", objName);
+      rei->status = -1;
+      return;
+    }
+  
+  std::vector<std::string> members;
+  listArchive(vsiRoot, "", members);
+  
+  //shapefile parts are paired from the member listing
+  std::set<std::string> names(members.begin(), members.end());
+  int nExtracted = 0;
+  
+  for(size_t i = 0; i < members.size(); i++)
+    {
+      boost::filesystem::path member(members[i]);
+      std::string ext = member.extension().string();
+      int sidecarsChecked = 0;
+      
+      if(extensionType(ext) != 1 && extensionType(ext) != 2)
+	continue;
+      
+      if(shapefilePart(ext))
+	{
+	  std::string stem = (member.parent_path() / member.stem()).string();
+	  if(ext != ".shp" ||
+	     !names.count(stem + ".shx") || !names.count(stem + ".dbf") || !names.count(stem + ".prj"))
+	    continue;
+	  sidecarsChecked = 1;
+	}
+      
+      ruleExecInfo_t memberRei = *rei;
+      std::vector<geoAVU> avus;
+      std::string logPath = name + "/" + members[i];
+      std::string phyPath = vsiRoot + members[i];
+      
+      memberRei.status = 0;
+      geoMetadata memberMetadata (&memberRei, logPath.c_str(), phyPath.c_str(), &avus, sidecarsChecked);
+      memberMetadata.archiveMember = 1;
+      
+      if(memberMetadata.extractGeoMeta() < 0)
+	{
+	  rodsLog(LOG_NOTICE, "msiExtractGeoMeta: no metadata extracted from %s in %s", members[i].c_str(), objName);
+	  continue;
+	}
+      
+      //the member path is the unit, keeping any unit the member set
+      for(size_t j = 0; j < avus.size(); j++)
+	{
+	  std::string unit = avus[j].keyValue ? members[i] : members[i] + "|" + avus[j].unit;
+	  addMetaUnit(avus[j].name.c_str(), avus[j].value.c_str(), unit.c_str());
+	}
+      
+      nExtracted++;
+    }
+  
+  if(nExtracted == 0)
+    {
+      rodsLog( LOG_ERROR, "msiExtractGeoMeta: No geospatial members found in %s", objName);
+      rei->status = -1;
+      return;
+    }
+  
+  char metaname[128];
+  char metavalue[128];
+  
+  snprintf(metaname, sizeof metaname, "type");
+  snprintf(metavalue, sizeof metavalue, "geospatial");
+  addMeta(metaname, metavalue);
+  
+  rei->status = setMeta();
+  
+  //every member's results in one batch
+  if(rei->status >= 0)
+    rei->status = setMetaUnits();
+  
+}
+
+void geoMetadata::appendEscaped(std::string &out, const std::string &field) {
+
+  //records are tab separated and one per line
+  for(size_t i = 0; i < field.size(); i++)
+    {
+      switch(field[i])
+	{
+	case '\t': out += "\\t"; break;
+	case '\n': out += "\\n"; break;
+	case '\r': out += "\\r"; break;
+	case '\\': out += "\\\\"; break;
+	default: out += field[i]; break;
+	}
+    }
+
+}
+
+std::string geoMetadata::unescape(const std::string &field) {
+
+  std::string out;
+
+  for(size_t i = 0; i < field.size(); i++)
+    {
+      if(field[i] != '\\' || i + 1 == field.size())
+	{
+	  out += field[i];
+	  continue;
+	}
+      switch(field[++i])
+	{
+	case 't': out += '\t'; break;
+	case 'n': out += '\n'; break;
+	case 'r': out += '\r'; break;
+	default: out += field[i]; break;
+	}
+    }
+
+  return out;
+
+}
+
+std::string geoMetadata::sha2Encode(const unsigned char *digest) {
+
+  //iRODS checksum notation, sha2: followed by the base64 digest
+  unsigned char encoded[4 * ((SHA256_DIGEST_LENGTH + 2) / 3) + 1];
+  EVP_EncodeBlock(encoded, digest, SHA256_DIGEST_LENGTH);
+
+  return std::string("sha2:") + (char *) encoded;
+
+}
+
+int geoMetadata::computeChecksum(const char *path, std::string &checksum) {
+
+  VSILFILE *fp = VSIFOpenL(path, "rb");
+  if(fp == NULL)
+    return -1;
+
+  std::vector<unsigned char> block(checksumBlockSize);
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+  size_t n;
+  int ok = ctx != NULL && EVP_DigestInit_ex(ctx, EVP_sha256(), NULL);
+
+  while(ok && (n = VSIFReadL(&block[0], 1, block.size(), fp)) > 0)
+    ok = EVP_DigestUpdate(ctx, &block[0], n);
+  ok = ok && EVP_DigestFinal_ex(ctx, digest, NULL);
+
+  EVP_MD_CTX_free(ctx);
+  VSIFCloseL(fp);
+
+  if(!ok)
+    return -1;
+
+  checksum = sha2Encode(digest);
+  return 0;
+
+}
+
+std::string geoMetadata::sha2Of(const std::string &data) {
+
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+
+  if(!EVP_Digest(data.data(), data.size(), digest, NULL, EVP_sha256(), NULL))
+    return "";
+
+  return sha2Encode(digest);
+
+}
+
+void geoMetadata::addChecksumMeta(const std::string &digest)
+{
+  //the fingerprint changes with the content and with anything that
+  //changes what is extracted from it, so unchanged objects can be
+  //recognised without extracting them again
+  std::string source = digest;
+  const char *options[] = {"footprint", "netcdf", "netcdf_member_limit", "quicklook"};
+  
+  source += "\ngeometa ";
+  source += extractorVersion;
+  source += "\nGDAL ";
+  source += GDALVersionInfo("RELEASE_NAME");
+  source += "\nnetCDF ";
+  source += nc_inq_libvers();
+  for(size_t i = 0; i < sizeof options / sizeof options[0]; i++)
+    source += std::string("\n") + options[i] + "=" + getOption(options[i]);
+  
+  //a changed file replaces both instead of adding a second pair
+  checksum = digest;
+  replaceMetaUnit("checksum", checksum.c_str(), "");
+  replaceMetaUnit("extraction_fingerprint", sha2Of(source).c_str(), "");
+}
+
+#ifndef GEOMETA_STANDALONE
+int geoMetadata::registerChecksum(dataObjInfo_t *dataObjInfo)
+{
+  //only for the replica that was read, an existing checksum is kept
+  if(getOption("checksum") != "register" || checksum.empty() ||
+     dataObjInfo == NULL || strlen(dataObjInfo->chksum) > 0 ||
+     strcmp(dataObjInfo->objPath, objName) != 0 || strcmp(dataObjInfo->filePath, filePath) != 0)
+    return 0;
+  
+  keyValPair_t regParam;
+  modDataObjMeta_t modDataObjMetaInp;
+  int status;
+  
+  bzero(&regParam, sizeof regParam);
+  addKeyVal(&regParam, CHKSUM_KW, checksum.c_str());
+  
+  modDataObjMetaInp.dataObjInfo = dataObjInfo;
+  modDataObjMetaInp.regParam = &regParam;
+  status = rsModDataObjMeta(rei->rsComm, &modDataObjMetaInp);
+  
+  clearKeyVal(&regParam);
+  
+  if(status < 0)
+    rodsLog(LOG_ERROR, "msiExtractGeoMeta: failed to register checksum of %s, status = %d", objName, status);
+  
+  return status;
+}
+#endif
+
+int geoMetadata::extractRemote(const char *socketPath)
+{
+  struct sockaddr_un addr;
+  struct timeval timeout;
+  std::string timeoutOption = getOption("daemon_timeout");
+  
+  bzero(&addr, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  if(strlen(socketPath) >= sizeof addr.sun_path)
+    return -1;
+  snprintf(addr.sun_path, sizeof addr.sun_path, "%s", socketPath);
+  
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0)
+    return -1;
+  
+  //a hung daemon must not hold the agent, give up and extract locally
+  timeout.tv_sec = timeoutOption.empty() ? 30 : atoi(timeoutOption.c_str());
+  timeout.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+  
+  if(connect(fd, (struct sockaddr *) &addr, sizeof addr) < 0)
+    {
+      close(fd);
+      return -1;
+    }
+  
+  //request: logical path <TAB> physical path
+  std::string request;
+  appendEscaped(request, objName);
+  request += "\t";
+  appendEscaped(request, filePath);
+  request += "\n";
+  
+  //response: OK <TAB> status <TAB> logical path, then one
+  //kind <TAB> attribute <TAB> value <TAB> unit line per AVU until the
+  //daemon closes the connection. BUSY means the daemon queue is full.
+  //kind is K (key value pair), A (AVU) or S (AVU written with set)
+  std::string response;
+  char buf[65536];
+  ssize_t n;
+  
+  if(write(fd, request.data(), request.size()) != (ssize_t) request.size())
+    {
+      close(fd);
+      return -1;
+    }
+  
+  while((n = read(fd, buf, sizeof buf)) > 0)
+    response.append(buf, n);
+  close(fd);
+  
+  if(n < 0 || response.compare(0, 3, "OK\t") != 0)
+    return -1;
+  
+  std::vector<std::string> lines;
+  size_t pos = 0, next;
+  while((next = response.find('\n', pos)) != std::string::npos)
+    {
+      lines.push_back(response.substr(pos, next - pos));
+      pos = next + 1;
+    }
+  
+  //an incomplete response is as good as none
+  if(lines.empty() || pos != response.size())
+    return -1;
+  
+  size_t tab = lines[0].find('\t', 3);
+  if(tab == std::string::npos)
+    return -1;
+  
+  int status = atoi(lines[0].substr(3, tab - 3).c_str());
+  
+  //the daemon may have moved the object to its .shp
+  snprintf(objName, sizeof objName, "%s", unescape(lines[0].substr(tab + 1)).c_str());
+  
+  //every line is checked before anything is queued, a malformed
+  //line (e.g. from a daemon of another version) means local extraction
+  std::vector<geoAVU> avus(lines.size() - 1);
+  for(size_t i = 1; i < lines.size(); i++)
+    {
+      size_t t0 = lines[i].find('\t');
+      size_t t1 = t0 == std::string::npos ? t0 : lines[i].find('\t', t0 + 1);
+      size_t t2 = t1 == std::string::npos ? t1 : lines[i].find('\t', t1 + 1);
+      std::string kind = lines[i].substr(0, t0);
+      if(t2 == std::string::npos || lines[i].find('\t', t2 + 1) != std::string::npos ||
+	 (kind != "K" && kind != "A" && kind != "S"))
+	return -1;
+      
+      avus[i - 1].keyValue = (kind == "K");
+      avus[i - 1].replace = (kind == "S");
+      avus[i - 1].name = unescape(lines[i].substr(t0 + 1, t1 - t0 - 1));
+      avus[i - 1].value = unescape(lines[i].substr(t1 + 1, t2 - t1 - 1));
+      avus[i - 1].unit = unescape(lines[i].substr(t2 + 1));
+    }
+  
+  for(size_t i = 0; i < avus.size(); i++)
+    {
+      if(avus[i].name == "checksum")
+	checksum = avus[i].value;
+      
+      //key value pairs replace by name, AVUs may repeat a name
+      if(avus[i].keyValue)
+	addMeta((char *) avus[i].name.c_str(), (char *) avus[i].value.c_str());
+      else if(avus[i].replace)
+	replaceMetaUnit(avus[i].name.c_str(), avus[i].value.c_str(), avus[i].unit.c_str());
+      else
+	addMetaUnit(avus[i].name.c_str(), avus[i].value.c_str(), avus[i].unit.c_str());
+    }
+  
+  rei->status = status;
+  
+  if(status >= 0 && lines.size() > 1)
+    {
+      rei->status = setMeta();
+      if(rei->status >= 0)
+	rei->status = setMetaUnits();
+    }
+  
+  return 0;
+}
+
 int geoMetadata::extractGeoMeta()
+{
+  int status = extractAny();
+  
+  //cached handles would keep the file open in a long lived agent or
+  //scanner thread, members run inside their bundle's extraction
+  if(!archiveMember)
+    geoContext::current().release();
+  
+  return status;
+}
+
+int geoMetadata::extractAny()
+{
+  //hand the file to the warm extraction daemon when one is configured,
+  //anything short of a complete answer falls back to local extraction
+  std::string socketPath = getOption("daemon_socket");
+  
+  //a NetCDF file that only grew along its unlimited dimension
+  //needs just its new records read
+  if(extractNetCDFAppend() == 0)
+    return rei->status;
+  
+  if(sink == NULL && catalog == NULL && geoType != 0 && !socketPath.empty() && extractRemote(socketPath.c_str()) == 0)
+    {
+      //companion objects need this agent's connection
+      if(rei->status >= 0 && geoType == 1 && optionEnabled("quicklook"))
+	{
+	  openDatasets();
+	  if(poDataset != NULL)
+	    extractQuicklook();
+	}
+      return rei->status;
+    }
+  
+  openDatasets();
+  
+  //the checksum streams the file next to the extraction, which then
+  //reads mostly from the page cache instead of storage, so the file
+  //leaves storage once for both
+  std::string digest;
+  int digestStatus = -1;
+  std::thread checksumWorker;
+  
+  //members are covered by the checksum of their bundle
+  if(geoType != 0 && !archiveMember && optionEnabled("checksum"))
+    checksumWorker = std::thread([this, &digest, &digestStatus]() {
+	digestStatus = computeChecksum(filePath, digest);
+      });
+  
+  int status = extractLocal();
+  
+  if(checksumWorker.joinable())
+    {
+      checksumWorker.join();
+      if(status >= 0 && digestStatus == 0)
+	{
+	  addChecksumMeta(digest);
+	  status = rei->status = setMetaUnits();
+	}
+    }
+  
+  return status;
+}
+
+int geoMetadata::extractLocal()
 {
   //call appropriate method based on geospatial file extension
   if(geoType == 1) //raster
@@ -782,7 +3278,12 @@ int geoMetadata::extractGeoMeta()
 	  extractMetaNetCDF();
 	  return rei->status;
 	}
-      else if(strcmp(geoExt,".tif") == 0)
+      //hdf containers have no format specific attributes beyond
+      //what GDAL exposes, so they share the geotiff path
+      else if((strcmp(geoExt,".tif") == 0) ||
+	      (strcmp(geoExt,".hdf") == 0) ||
+	      (strcmp(geoExt,".h5") == 0) ||
+	      (strcmp(geoExt,".he5") == 0))
 	{
 	  extractMetaGeoTiff();
 	  return rei->status;
@@ -802,6 +3303,11 @@ int geoMetadata::extractGeoMeta()
       extractMetaShp();
       return rei->status;
     }
+  else if(geoType == 3) //archive
+    {
+      extractMetaArchive();
+      return rei->status;
+    }
 
   else
     {
@@ -812,14 +3318,49 @@ int geoMetadata::extractGeoMeta()
 }
 
 //geospatial file extensions initialization
-const std::vector<std::string> geoMetadata::rastertypes({".tif",".nc"});
+const std::vector<std::string> geoMetadata::rastertypes({".tif",".nc",".hdf",".h5",".he5"});
 
 //vectors need to include non-shp files to allow for metadata extractor to be called 
 //on shp-associated files from acPostProcForPut rules since order of upload may 
 //vary and we need to wait until these four files have been uploaded to extract
 //shpfile metadata. See shapefileComplete for more details
-const std::vector<std::string> geoMetadata::vectortypes({".shp", ".shx", ".prj", ".dbf"});
+const std::vector<std::string> geoMetadata::vectortypes({".shp", ".shx", ".prj", ".dbf", ".gpkg", ".gml"});
+
+//bundles whose members are extracted in place through GDAL's
+//virtual file systems, .gz is only accepted as .tar.gz
+const std::vector<std::string> geoMetadata::archivetypes({".zip", ".tar", ".tgz", ".gz"});
+
+//the subset of vectortypes that belong to a multi-file shapefile
+const std::vector<std::string> geoMetadata::shapefiletypes({".shp", ".shx", ".prj", ".dbf"});
+
+const int geoMetadata::maxThreads = 8;
+const size_t geoMetadata::maxValueLength = 2700;
+const int geoMetadata::maxChunks = 16;
+
+const int geoMetadata::variableMaxChunks = 512;
+
+const size_t geoMetadata::maxLongName = 1024;
+const int geoMetadata::footprintMaxPixels = 512 * 512;
+const int geoMetadata::footprintMaxVertices = 100;
+const int geoMetadata::footprintGridSize = 256;
+const long long geoMetadata::footprintChunkFeatures = 65536;
 
+const int geoMetadata::quicklookSize = 256;
+const double geoMetadata::quicklookClip = 0.02;
+
+const size_t geoMetadata::checksumBlockSize = 1 << 20;
+
+//part of the extraction fingerprint, bump it with every change
+//to what is extracted
+const char *const geoMetadata::extractorVersion = "1.1";
+
+const size_t geoMetadata::coordinateBlockSize = 65536;
+
+const size_t geoMetadata::netcdfMemoryLimit = (size_t) 64 << 20;
+
+const size_t hullBuilder::maxPoints = 65536;
+
+#ifndef GEOMETA_STANDALONE
 extern "C" {
 
   // =-=-=-=-=-=-=-
@@ -849,6 +3390,10 @@ extern "C" {
     // Call geoMetadata::extractGeoMeta
     rei->status = myGeoMetadata.extractGeoMeta();
     
+    // Record the streamed checksum as the catalog checksum
+    if ( rei->status >= 0 )
+      myGeoMetadata.registerChecksum( dataObjInfoHead );
+    
     // Done
     return rei->status;
     
@@ -875,4 +3420,4 @@ extern "C" {
   }
   
 }; // extern "C"
-
+#endif